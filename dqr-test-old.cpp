@@ -1,77 +1,270 @@
+#include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
+#include <new>
+#include <utility>
 #include <vector>
 #include <complex> // std::complex を使用する場合
+#include "gemm.h"
 
 using namespace std;
 
 // 既存のライブラリ (Vector_lib, Matrix_lib) の型定義と関数をここに含める (簡略化のため、必要な部分のみ)
+// ライブラリと違い, ムーブ構築・ムーブ代入と式テンプレートを持つ.
+// 演算子は計算結果ではなく式 (MatrixExpr, VectorExpr) を返し, 代入先に1パスで直接評価される.
+// 行列積だけは要素ごとに O(n) かかるので, 積の中の積は先に一時行列に評価し,
+// 代入先が積の右辺にも現れるとき (A = G * A など) は一時行列に計算してから入れ替える
+//
+// 要素は 64 バイト境界に揃えた0始まりの連続領域 (行列は行優先) に置き, (i, j) での1始まりの参照は
+// そのまま使える. MatrixView, VectorView は行列の一部 (行, 列, 部分行列, 転置) を複写せずに指す
+// 非所有のビューで, 式の中でも代入先としても行列と同じように使える
+
+// ヒープ確保の回数を数えるための operator new の置き換え
+static long allocation_count = 0;
+
+void* operator new(size_t size) {
+    allocation_count++;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+// 64 バイト (キャッシュライン, AVX-512 のレジスタ幅) 境界に揃えた double の配列の確保と解放
+// 確保した領域の先頭を, 揃えた先頭の直前に保存しておく
+const size_t storage_alignment = 64;
+
+double* allocate_aligned(size_t n) {
+    void* raw = ::operator new(n * sizeof(double) + storage_alignment + sizeof(void*));
+    uintptr_t p = (reinterpret_cast<uintptr_t>(raw) + sizeof(void*) + storage_alignment - 1)
+                  & ~(uintptr_t)(storage_alignment - 1);
+    reinterpret_cast<void**>(p)[-1] = raw;
+    return reinterpret_cast<double*>(p);
+}
+
+void free_aligned(double* p) {
+    if (p) ::operator delete(reinterpret_cast<void**>(p)[-1]);
+}
+
+// 要素の配置 (要素 (i, j) は data[(i-1) * row_stride + (j-1) * col_stride], ベクトルは col_stride = 0)
+// 代入先と式の中の行列が同じ領域を指すときに, 直接書き込んでよいかの判定に使う
+struct Storage {
+    const double* data;
+    int row_stride, col_stride;
+    const double* begin;   // 要素が占める範囲 [begin, end)
+    const double* end;
+
+    bool overlaps(const Storage& s) const { return begin < s.end && s.begin < end; }
+    bool same_layout(const Storage& s) const {
+        return data == s.data && row_stride == s.row_stride && col_stride == s.col_stride;
+    }
+};
+
+Storage make_storage(const double* data, int m, int n, int row_stride, int col_stride) {
+    Storage s = {data, row_stride, col_stride, data, data};
+    if (m > 0 && n > 0) s.end = data + (size_t)(m - 1) * row_stride + (size_t)(n - 1) * col_stride + 1;
+    return s;
+}
+
+class Vector;
+class Matrix;
+class VectorView;
+class MatrixView;
+
+// 式の中での部分式の持ち方 (Vector, Matrix は参照, それ以外の式とビューは値で持つ)
+template <class T> struct expr_ref { typedef const T type; };
+template <> struct expr_ref<Vector> { typedef const Vector& type; };
+template <> struct expr_ref<Matrix> { typedef const Matrix& type; };
+
+// ベクトルの式 (E は size() と operator()(i) を持つ)
+// references(s) は式が領域 s を読むかどうか, unsafe_alias(s) は s に直接書き込むと
+// まだ読んでいない要素を壊すかどうか (s と違う配置で s を読む場合) を返す
+template <class E>
+struct VectorExpr {
+    const E& self() const { return static_cast<const E&>(*this); }
+};
+
+template <class L, class R>
+class VectorSum : public VectorExpr<VectorSum<L, R> > {
+public:
+    VectorSum(const L& l, const R& r, double sign) : l_(l), r_(r), sign_(sign) {}
+    int size() const { return l_.size(); }
+    double operator()(int i) const { return l_(i) + sign_ * r_(i); }
+    bool references(const Storage& s) const { return l_.references(s) || r_.references(s); }
+    bool unsafe_alias(const Storage& s) const { return l_.unsafe_alias(s) || r_.unsafe_alias(s); }
+private:
+    typename expr_ref<L>::type l_;
+    typename expr_ref<R>::type r_;
+    double sign_;   // +1 なら和, -1 なら差
+};
+
+template <class E>
+class VectorScaled : public VectorExpr<VectorScaled<E> > {
+public:
+    VectorScaled(const E& e, double c, bool divide) : e_(e), c_(c), divide_(divide) {}
+    int size() const { return e_.size(); }
+    double operator()(int i) const { return divide_ ? e_(i) / c_ : e_(i) * c_; }
+    bool references(const Storage& s) const { return e_.references(s); }
+    bool unsafe_alias(const Storage& s) const { return e_.unsafe_alias(s); }
+private:
+    typename expr_ref<E>::type e_;
+    double c_;
+    bool divide_;
+};
+
+// ベクトルの一部や行列の行・列を指す非所有のビュー (要素 i は p[(i-1) * stride])
+// 代入は指している先の要素を書き換える
+class VectorView : public VectorExpr<VectorView> {
+public:
+    VectorView(double* p, int n, int stride) : p_(p), size_(n), stride_(stride) {}
+    VectorView(const VectorView&) = default;
+
+    int size() const { return size_; }
+    int stride() const { return stride_; }
+    double* data() const { return p_; }
+    double& operator()(int i) const { return p_[(ptrdiff_t)(i - 1) * stride_]; }
+
+    // i 番目から len 個の要素
+    VectorView segment(int i, int len) const { return VectorView(&(*this)(i), len, stride_); }
+
+    Storage storage() const { return make_storage(p_, size_, 1, stride_, 0); }
+    bool references(const Storage& s) const { return storage().overlaps(s); }
+    bool unsafe_alias(const Storage& s) const { return references(s) && !storage().same_layout(s); }
+
+    VectorView& operator=(const VectorView& x) { return assign(x); }
+    template <class E>
+    VectorView& operator=(const VectorExpr<E>& e) { return assign(e.self()); }
+
+private:
+    double* p_;
+    int size_, stride_;
+
+    template <class E>
+    VectorView& assign(const E& x);
+};
 
 // Vector_lib.h から必要な部分をコピー (簡略化)
-class Vector {
+class Vector : public VectorExpr<Vector> {
 public:
-    Vector() : size_(3), maxsize_(3), p_(new double[3]), p1_(p_ - 1) { initialize(); } // デフォルトサイズを3に設定
-    explicit Vector(int n) : size_(n), maxsize_(n), p_(new double[n]), p1_(p_ - 1) { initialize(); }
-    Vector(const Vector& X) : size_(X.size_), maxsize_(X.size_), p_(new double[X.size_]), p1_(p_ - 1) {
+    Vector() : size_(3), maxsize_(3), p_(allocate_aligned(3)) { initialize(); } // デフォルトサイズを3に設定
+    explicit Vector(int n) : size_(n), maxsize_(n), p_(allocate_aligned(n)) { initialize(); }
+    Vector(const Vector& X) : size_(X.size_), maxsize_(X.size_), p_(allocate_aligned(X.size_)) {
         for (int i = 1; i <= size_; ++i) (*this)(i) = X(i);
     }
-    ~Vector() { delete[] p_; }
+    Vector(Vector&& X) noexcept : size_(X.size_), maxsize_(X.maxsize_), p_(X.p_) {
+        X.size_ = X.maxsize_ = 0;
+        X.p_ = nullptr;
+    }
+    template <class E>
+    Vector(const VectorExpr<E>& e) : size_(e.self().size()), maxsize_(size_), p_(allocate_aligned(size_)) {
+        for (int i = 1; i <= size_; ++i) (*this)(i) = e.self()(i);
+    }
+    ~Vector() { free_aligned(p_); }
 
     int size() const { return size_; }
-    double& operator()(int i) const { return *(p1_ + i); }
+    double* data() const { return p_; }
+    double& operator()(int i) const { return p_[i - 1]; }
+
+    // i 番目から len 個の要素のビュー
+    VectorView segment(int i, int len) const { return VectorView(p_ + (i - 1), len, 1); }
+
+    Storage storage() const { return make_storage(p_, size_, 1, 1, 0); }
+    bool references(const Storage& s) const { return storage().overlaps(s); }
+    bool unsafe_alias(const Storage& s) const { return references(s) && !storage().same_layout(s); }
+
     Vector& operator=(const Vector& X) {
         if (&X == this) return *this;
-        resize(X.size_);
+        reserve(X.size_);
         for (int i = 1; i <= size_; ++i) (*this)(i) = X(i);
         return *this;
     }
-    Vector operator-(const Vector& X) const {
-        Vector result(size_);
-        for (int i = 1; i <= size_; ++i) result(i) = (*this)(i) - X(i);
-        return result;
-    }
-    Vector operator+(const Vector& X) const {
-        Vector result(size_);
-        for (int i = 1; i <= size_; ++i) result(i) = (*this)(i) + X(i);
-        return result;
-    }
-    double operator*(const Vector& X) const {
-        double sum = 0.0;
-        for (int i = 1; i <= size_; ++i) sum += (*this)(i) * X(i);
-        return sum;
-    }
-    Vector operator*(double c) const {
-        Vector result(size_);
-        for (int i = 1; i <= size_; ++i) result(i) = (*this)(i) * c;
-        return result;
+    Vector& operator=(Vector&& X) noexcept {
+        std::swap(size_, X.size_);
+        std::swap(maxsize_, X.maxsize_);
+        std::swap(p_, X.p_);
+        return *this;
     }
-    Vector operator/(double c) const {
-        Vector result(size_);
-        for (int i = 1; i <= size_; ++i) result(i) = (*this)(i) / c;
-        return result;
+    // 要素ごとの式は同じ位置の要素しか読まないので, 代入先が式に含まれていても直接書き込める
+    // (代入先の一部を指すビューを読む場合と, 大きさが変わる場合は一時ベクトルに計算する)
+    template <class E>
+    Vector& operator=(const VectorExpr<E>& e) {
+        const E& x = e.self();
+        if (x.references(storage()) && (x.unsafe_alias(storage()) || x.size() != size_)) {
+            Vector result(e);
+            *this = std::move(result);
+            return *this;
+        }
+        reserve(x.size());
+        for (int i = 1; i <= size_; ++i) (*this)(i) = x(i);
+        return *this;
     }
     friend ostream& operator<<(ostream& os, const Vector& X); // フレンド関数として宣言
 
 
     void resize(int n) {
-        if (n > maxsize_) {
-            delete[] p_;
-            maxsize_ = n;
-            p_ = new double[maxsize_];
-            p1_ = p_ - 1;
-        }
-        size_ = n;
+        reserve(n);
         initialize();
     }
 
 private:
-    double* p_;
-    double* p1_;
     int size_;
     int maxsize_ = 0;
+    double* p_;
     void initialize() { for (int i = 1; i <= size_; ++i) (*this)(i) = 0.0; }
+    // 大きさだけを変える (要素は不定)
+    void reserve(int n) {
+        if (n > maxsize_) {
+            free_aligned(p_);
+            maxsize_ = n;
+            p_ = allocate_aligned(maxsize_);
+        }
+        size_ = n;
+    }
 };
 
+template <class E>
+VectorView& VectorView::assign(const E& x) {
+    if (x.unsafe_alias(storage())) {
+        Vector result(x);
+        for (int i = 1; i <= size_; ++i) (*this)(i) = result(i);
+    } else {
+        for (int i = 1; i <= size_; ++i) (*this)(i) = x(i);
+    }
+    return *this;
+}
+
+template <class L, class R>
+VectorSum<L, R> operator+(const VectorExpr<L>& x, const VectorExpr<R>& y) {
+    return VectorSum<L, R>(x.self(), y.self(), 1.0);
+}
+
+template <class L, class R>
+VectorSum<L, R> operator-(const VectorExpr<L>& x, const VectorExpr<R>& y) {
+    return VectorSum<L, R>(x.self(), y.self(), -1.0);
+}
+
+template <class E>
+VectorScaled<E> operator*(const VectorExpr<E>& x, double c) { return VectorScaled<E>(x.self(), c, false); }
+
+template <class E>
+VectorScaled<E> operator*(double c, const VectorExpr<E>& x) { return VectorScaled<E>(x.self(), c, false); }
+
+template <class E>
+VectorScaled<E> operator/(const VectorExpr<E>& x, double c) { return VectorScaled<E>(x.self(), c, true); }
+
+// 内積
+template <class L, class R>
+double operator*(const VectorExpr<L>& x, const VectorExpr<R>& y) {
+    double sum = 0.0;
+    for (int i = 1; i <= x.self().size(); ++i) sum += x.self()(i) * y.self()(i);
+    return sum;
+}
+
 ostream& operator<<(ostream& os, const Vector& X) { // 実装を追加
     for (int i = 1; i <= X.size(); ++i) {
         os << X(i) << endl;
@@ -80,75 +273,283 @@ ostream& operator<<(ostream& os, const Vector& X) { // 実装を追加
 }
 
 
-double norm(const Vector& X) {
+template <class E>
+double norm(const VectorExpr<E>& X) {
     double w = 0.0;
-    for (int i = 1; i <= X.size(); ++i) w += X(i) * X(i);
+    for (int i = 1; i <= X.self().size(); ++i) w += X.self()(i) * X.self()(i);
     return sqrt(w);
 }
 
+// 行列の式 (E は row(), col(), operator()(i, j) を持つ)
+// references, unsafe_alias はベクトルの式と同じ. 転置と積は代入先と同じ領域を読むだけで unsafe になる
+template <class E>
+struct MatrixExpr {
+    const E& self() const { return static_cast<const E&>(*this); }
+};
+
+template <class L, class R>
+class MatrixSum : public MatrixExpr<MatrixSum<L, R> > {
+public:
+    MatrixSum(const L& l, const R& r, double sign) : l_(l), r_(r), sign_(sign) {}
+    int row() const { return l_.row(); }
+    int col() const { return l_.col(); }
+    double operator()(int i, int j) const { return l_(i, j) + sign_ * r_(i, j); }
+    bool references(const Storage& s) const { return l_.references(s) || r_.references(s); }
+    bool unsafe_alias(const Storage& s) const { return l_.unsafe_alias(s) || r_.unsafe_alias(s); }
+private:
+    typename expr_ref<L>::type l_;
+    typename expr_ref<R>::type r_;
+    double sign_;   // +1 なら和, -1 なら差
+};
+
+template <class E>
+class MatrixScaled : public MatrixExpr<MatrixScaled<E> > {
+public:
+    MatrixScaled(const E& e, double c) : e_(e), c_(c) {}
+    int row() const { return e_.row(); }
+    int col() const { return e_.col(); }
+    double operator()(int i, int j) const { return c_ * e_(i, j); }
+    bool references(const Storage& s) const { return e_.references(s); }
+    bool unsafe_alias(const Storage& s) const { return e_.unsafe_alias(s); }
+private:
+    typename expr_ref<E>::type e_;
+    double c_;
+};
+
+template <class E>
+class MatrixTranspose : public MatrixExpr<MatrixTranspose<E> > {
+public:
+    explicit MatrixTranspose(const E& e) : e_(e) {}
+    const E& argument() const { return e_; }
+    int row() const { return e_.col(); }
+    int col() const { return e_.row(); }
+    double operator()(int i, int j) const { return e_(j, i); }
+    bool references(const Storage& s) const { return e_.references(s); }
+    bool unsafe_alias(const Storage& s) const { return e_.references(s); }
+private:
+    typename expr_ref<E>::type e_;
+};
+
+// ベクトルのテンソル積 x y^T (x, y が代入先の行や列のビューなら, 書き込みで読む前の値が変わる)
+template <class L, class R>
+class MatrixOuter : public MatrixExpr<MatrixOuter<L, R> > {
+public:
+    MatrixOuter(const L& x, const R& y) : x_(x), y_(y) {}
+    int row() const { return x_.size(); }
+    int col() const { return y_.size(); }
+    double operator()(int i, int j) const { return x_(i) * y_(j); }
+    bool references(const Storage& s) const { return x_.references(s) || y_.references(s); }
+    bool unsafe_alias(const Storage& s) const { return references(s); }
+private:
+    typename expr_ref<L>::type x_;
+    typename expr_ref<R>::type y_;
+};
+
+template <class L, class R> class MatrixProduct;
+
+// 行列 (かその転置) なら要素の連続領域の先頭と行の間隔, 行列でない式なら nullptr
+template <class E>
+const double* dense_data(const E&, bool&, int&) { return nullptr; }
+const double* dense_data(const Matrix& A, bool& transposed, int& ld);
+const double* dense_data(const MatrixTranspose<Matrix>& A, bool& transposed, int& ld);
+const double* dense_data(const MatrixView& A, bool& transposed, int& ld);
+
+// 代入先の行が連続していれば先頭と行の間隔, そうでなければ nullptr
+template <class M>
+double* dense_target(M&, int&) { return nullptr; }
+double* dense_target(Matrix& A, int& ld);
+double* dense_target(MatrixView& A, int& ld);
+
+// 積の内側のループ d(1..n) += a * B(k, 1..n). 右の因子が Matrix なら行を直接読む
+template <class E>
+void add_scaled_row(double* d, double a, const E& B, int k, int n) {
+    for (int j = 1; j <= n; ++j) d[j] += a * B(k, j);
+}
+void add_scaled_row(double* d, double a, const Matrix& B, int k, int n);
+
+// 積の因子の持ち方 (積の中の積は一時行列に評価して持つ)
+template <class T> struct product_ref { typedef typename expr_ref<T>::type type; };
+template <class L, class R> struct product_ref<MatrixProduct<L, R> > { typedef const Matrix type; };
+
+// 行列積. 代入するときは i-k-j の順の積和で代入先に直接書き込む
+template <class L, class R>
+class MatrixProduct : public MatrixExpr<MatrixProduct<L, R> > {
+public:
+    MatrixProduct(const L& l, const R& r) : l_(l), r_(r) {}
+    int row() const { return l_.row(); }
+    int col() const { return r_.col(); }
+    double operator()(int i, int j) const {
+        double sum = 0.0;
+        for (int k = 1; k <= l_.col(); ++k) sum += l_(i, k) * r_(k, j);
+        return sum;
+    }
+    bool references(const Storage& s) const { return l_.references(s) || r_.references(s); }
+    bool unsafe_alias(const Storage& s) const { return references(s); }
+    template <class M>
+    void evaluate_to(M& dst) const {
+        int m = row(), n = col(), p = l_.col();
+        // 両方の因子が行列 (かその転置) なら連続領域のまま gemm (gemm.h) で計算する
+        bool ta, tb;
+        int lda, ldb, ldc;
+        const double* a = dense_data(l_, ta, lda);
+        const double* b = dense_data(r_, tb, ldb);
+        double* c = dense_target(dst, ldc);
+        if (a && b && c) {
+            gemm(ta, tb, m, n, p, a, lda, b, ldb, c, ldc, false, gemm_best_kernel());
+            return;
+        }
+        for (int i = 1; i <= m; ++i) {
+            if (c) {
+                double* d = c + (size_t)(i - 1) * ldc - 1;
+                for (int j = 1; j <= n; ++j) d[j] = 0.0;
+                for (int k = 1; k <= p; ++k) add_scaled_row(d, l_(i, k), r_, k, n);
+            } else {
+                for (int j = 1; j <= n; ++j) dst(i, j) = 0.0;
+                for (int k = 1; k <= p; ++k) {
+                    double a = l_(i, k);
+                    for (int j = 1; j <= n; ++j) dst(i, j) += a * r_(k, j);
+                }
+            }
+        }
+    }
+private:
+    typename product_ref<L>::type l_;
+    typename product_ref<R>::type r_;
+};
+
+// 式を代入先に評価する (積以外は要素ごとに1パス)
+template <class E, class M>
+void evaluate_to(const MatrixExpr<E>& e, M& dst) {
+    const E& x = e.self();
+    for (int i = 1; i <= x.row(); ++i) {
+        for (int j = 1; j <= x.col(); ++j) dst(i, j) = x(i, j);
+    }
+}
+
+template <class L, class R, class M>
+void evaluate_to(const MatrixExpr<MatrixProduct<L, R> >& e, M& dst) {
+    e.self().evaluate_to(dst);
+}
+
+// 行列の一部を指す非所有のビュー (要素 (i, j) は p[(i-1) * row_stride + (j-1) * col_stride])
+// 部分行列 block, 行 row_view, 列 col_view, 転置 transpose も元の領域を指すビューになり,
+// ビューへの代入は元の行列を書き換える (元の行列より長く使ってはいけない)
+class MatrixView : public MatrixExpr<MatrixView> {
+public:
+    MatrixView(double* p, int m, int n, int row_stride, int col_stride)
+        : p_(p), row_(m), col_(n), row_stride_(row_stride), col_stride_(col_stride) {}
+    MatrixView(const MatrixView&) = default;
+
+    int row() const { return row_; }
+    int col() const { return col_; }
+    int row_stride() const { return row_stride_; }
+    int col_stride() const { return col_stride_; }
+    double* data() const { return p_; }
+    double& operator()(int i, int j) const {
+        return p_[(ptrdiff_t)(i - 1) * row_stride_ + (ptrdiff_t)(j - 1) * col_stride_];
+    }
+
+    // (i, j) から始まる m x n の部分行列
+    MatrixView block(int i, int j, int m, int n) const {
+        return MatrixView(&(*this)(i, j), m, n, row_stride_, col_stride_);
+    }
+    MatrixView transpose() const { return MatrixView(p_, col_, row_, col_stride_, row_stride_); }
+    VectorView row_view(int i) const { return VectorView(&(*this)(i, 1), col_, col_stride_); }
+    VectorView col_view(int j) const { return VectorView(&(*this)(1, j), row_, row_stride_); }
+
+    Storage storage() const { return make_storage(p_, row_, col_, row_stride_, col_stride_); }
+    bool references(const Storage& s) const { return storage().overlaps(s); }
+    bool unsafe_alias(const Storage& s) const { return references(s) && !storage().same_layout(s); }
+
+    MatrixView& operator=(const MatrixView& A) { return assign(A); }
+    template <class E>
+    MatrixView& operator=(const MatrixExpr<E>& e) { return assign(e); }
+
+private:
+    double* p_;
+    int row_, col_, row_stride_, col_stride_;
+
+    template <class E>
+    MatrixView& assign(const MatrixExpr<E>& e);
+};
+
+// 行列の要素を並べて代入するための補助 (A = 1, 2, 3, ...)
+class MatrixCommaInitializer {
+public:
+    MatrixCommaInitializer(Matrix& A, int k) : A_(A), k_(k) {}
+    MatrixCommaInitializer& operator,(double v);
+private:
+    Matrix& A_;
+    int k_;
+};
+
 // Matrix_lib.h から必要な部分をコピー (簡略化)
-class Matrix {
+class Matrix : public MatrixExpr<Matrix> {
 public:
-    Matrix() : row_(3), col_(3), maxsize_(9), p_(new double[9]), p1_(p_ - 4) { initialize(); } // デフォルトサイズを3x3に設定
-    explicit Matrix(int n) : row_(n), col_(n), maxsize_(n * n), p_(new double[n * n]), p1_(p_ - (n + 1)) { initialize(); }
-    Matrix(int m, int n) : row_(m), col_(n), maxsize_(m * n), p_(new double[m * n]), p1_(p_ - (n + 1)) { initialize(); }
-    Matrix(const Matrix& A) : row_(A.row_), col_(A.col_), maxsize_(A.maxsize_), p_(new double[A.maxsize_]), p1_(p_ - (A.col_ + 1)) {
+    Matrix() : row_(3), col_(3), maxsize_(9), p_(allocate_aligned(9)) { initialize(); } // デフォルトサイズを3x3に設定
+    explicit Matrix(int n) : row_(n), col_(n), maxsize_(n * n), p_(allocate_aligned(n * n)) { initialize(); }
+    Matrix(int m, int n) : row_(m), col_(n), maxsize_(m * n), p_(allocate_aligned(m * n)) { initialize(); }
+    Matrix(const Matrix& A) : row_(A.row_), col_(A.col_), maxsize_(A.row_ * A.col_), p_(allocate_aligned(maxsize_)) {
         for (int i = 1; i <= row_; ++i) {
             for (int j = 1; j <= col_; ++j) (*this)(i, j) = A(i, j);
         }
     }
-    ~Matrix() { delete[] p_; }
+    Matrix(Matrix&& A) noexcept : row_(A.row_), col_(A.col_), maxsize_(A.maxsize_), p_(A.p_) {
+        A.row_ = A.col_ = A.maxsize_ = 0;
+        A.p_ = nullptr;
+    }
+    template <class E>
+    Matrix(const MatrixExpr<E>& e)
+        : row_(e.self().row()), col_(e.self().col()), maxsize_(row_ * col_), p_(allocate_aligned(maxsize_)) {
+        evaluate_to(e, *this);
+    }
+    ~Matrix() { free_aligned(p_); }
 
     int row() const { return row_; }
     int col() const { return col_; }
+    double* data() const { return p_; }
     double* operator[](int i) const { return p_ + i * col_; }
-    double& operator()(int i, int j) const { return *(p1_ + i * col_ + j); }
+    double& operator()(int i, int j) const { return p_[(size_t)(i - 1) * col_ + (j - 1)]; }
+
+    // 行列全体, (i, j) から始まる m x n の部分行列, 行, 列, 転置のビュー
+    MatrixView view() const { return MatrixView(p_, row_, col_, col_, 1); }
+    MatrixView block(int i, int j, int m, int n) const { return MatrixView(&(*this)(i, j), m, n, col_, 1); }
+    VectorView row_view(int i) const { return VectorView(&(*this)(i, 1), col_, 1); }
+    VectorView col_view(int j) const { return VectorView(&(*this)(1, j), row_, col_); }
+    MatrixView transpose_view() const { return view().transpose(); }
+
+    Storage storage() const { return make_storage(p_, row_, col_, col_, 1); }
+    bool references(const Storage& s) const { return storage().overlaps(s); }
+    bool unsafe_alias(const Storage& s) const { return references(s) && !storage().same_layout(s); }
+
     Matrix& operator=(const Matrix& A) {
         if (&A == this) return *this;
-        resize(A.row_, A.col_);
+        reserve(A.row_, A.col_);
         for (int i = 1; i <= row_; ++i) {
             for (int j = 1; j <= col_; ++j) (*this)(i, j) = A(i, j);
         }
         return *this;
     }
-    Matrix operator*(const Matrix& B) const {
-        Matrix result(row_, B.col_);
-        for (int i = 1; i <= row_; ++i) {
-            for (int j = 1; j <= B.col(); ++j) {
-                double sum = 0.0;
-                for (int k = 1; k <= col_; ++k) sum += (*this)(i, k) * B(k, j);
-                result(i, j) = sum;
-            }
-        }
-        return result;
-    }
-    Matrix operator*(double c) const {
-        Matrix result(row_, col_);
-        for (int i = 1; i <= row_; ++i) {
-            for (int j = 1; j <= col_; ++j) result(i, j) = (*this)(i, j) * c;
-        }
-        return result;
-    }
-    Matrix operator+(const Matrix& B) const {
-        Matrix result(row_, col_);
-        for (int i = 1; i <= row_; ++i) {
-            for (int j = 1; j <= col_; ++j) result(i, j) = (*this)(i, j) + B(i, j);
-        }
-        return result;
+    Matrix& operator=(Matrix&& A) noexcept {
+        swap(A);
+        return *this;
     }
-    Matrix operator-(const Matrix& B) const {
-        Matrix result(row_, col_);
-        for (int i = 1; i <= row_; ++i) {
-            for (int j = 1; j <= col_; ++j) result(i, j) = (*this)(i, j) - B(i, j);
+    // 式が自分を読んでいて, 直接書き込むと読む前の要素を壊す場合と大きさが変わる場合は一時行列に計算する
+    template <class E>
+    Matrix& operator=(const MatrixExpr<E>& e) {
+        const E& x = e.self();
+        if (x.references(storage()) && (x.unsafe_alias(storage()) || x.row() != row_ || x.col() != col_)) {
+            Matrix result(e);
+            swap(result);
+        } else {
+            reserve(x.row(), x.col());
+            evaluate_to(e, *this);
         }
-        return result;
+        return *this;
     }
-    Matrix operator-() const {
-        Matrix result(row_, col_);
-        for (int i = 1; i <= row_; ++i) {
-            for (int j = 1; j <= col_; ++j) result(i, j) = -(*this)(i, j);
-        }
-        return result;
+    MatrixCommaInitializer operator=(double v) {
+        (*this)(1, 1) = v;
+        return MatrixCommaInitializer(*this, 1);
     }
 
     static Matrix identity(int n) {
@@ -161,25 +562,86 @@ public:
 
 
     void resize(int m, int n) {
-        if (m * n > maxsize_) {
-            delete[] p_;
-            maxsize_ = m * n;
-            p_ = new double[maxsize_];
-            p1_ = p_ - (n + 1);
-        }
-        row_ = m;
-        col_ = n;
+        reserve(m, n);
         initialize();
     }
 
+    void swap(Matrix& A) noexcept {
+        std::swap(row_, A.row_);
+        std::swap(col_, A.col_);
+        std::swap(maxsize_, A.maxsize_);
+        std::swap(p_, A.p_);
+    }
+
 
 private:
     int row_, col_, maxsize_;
     double* p_;
-    double* p1_;
     void initialize() { for (int i = 1; i <= row_; ++i) for (int j = 1; j <= col_; ++j) (*this)(i, j) = 0.0; }
+    // 大きさだけを変える (要素は不定)
+    void reserve(int m, int n) {
+        if (m * n > maxsize_) {
+            free_aligned(p_);
+            maxsize_ = m * n;
+            p_ = allocate_aligned(maxsize_);
+        }
+        row_ = m;
+        col_ = n;
+    }
 };
 
+template <class E>
+MatrixView& MatrixView::assign(const MatrixExpr<E>& e) {
+    if (e.self().unsafe_alias(storage())) {
+        Matrix result(e);
+        for (int i = 1; i <= row_; ++i) {
+            for (int j = 1; j <= col_; ++j) (*this)(i, j) = result(i, j);
+        }
+    } else {
+        evaluate_to(e, *this);
+    }
+    return *this;
+}
+
+const double* dense_data(const Matrix& A, bool& transposed, int& ld) {
+    transposed = false;
+    ld = A.col();
+    return A.data();
+}
+
+const double* dense_data(const MatrixTranspose<Matrix>& A, bool& transposed, int& ld) {
+    transposed = true;
+    ld = A.argument().col();
+    return A.argument().data();
+}
+
+const double* dense_data(const MatrixView& A, bool& transposed, int& ld) {
+    transposed = A.col_stride() != 1;
+    ld = transposed ? A.col_stride() : A.row_stride();
+    return (A.col_stride() == 1 || A.row_stride() == 1) ? A.data() : nullptr;
+}
+
+double* dense_target(Matrix& A, int& ld) {
+    ld = A.col();
+    return A.data();
+}
+
+double* dense_target(MatrixView& A, int& ld) {
+    ld = A.row_stride();
+    return A.col_stride() == 1 ? A.data() : nullptr;
+}
+
+void add_scaled_row(double* d, double a, const Matrix& B, int k, int n) {
+    const double* b = &B(k, 1) - 1;
+    for (int j = 1; j <= n; ++j) d[j] += a * b[j];
+}
+
+MatrixCommaInitializer& MatrixCommaInitializer::operator,(double v) {
+    k_++;
+    A_((k_ - 1) / A_.col() + 1, (k_ - 1) % A_.col() + 1) = v;
+    return *this;
+}
+
 ostream& operator<<(ostream& os, const Matrix& A) { // 実装を追加
     for (int i = 1; i <= A.row(); ++i) {
         for (int j = 1; j <= A.col(); ++j) {
@@ -191,58 +653,132 @@ ostream& operator<<(ostream& os, const Matrix& A) { // 実装を追加
 }
 
 
-Matrix trans(const Matrix& A) {
-    Matrix w(A.col(), A.row());
-    for (int i = 1; i <= A.row(); ++i) {
-        for (int j = 1; j <= A.col(); ++j) w(j, i) = A(i, j);
-    }
-    return w;
+template <class L, class R>
+MatrixSum<L, R> operator+(const MatrixExpr<L>& A, const MatrixExpr<R>& B) {
+    return MatrixSum<L, R>(A.self(), B.self(), 1.0);
+}
+
+template <class L, class R>
+MatrixSum<L, R> operator-(const MatrixExpr<L>& A, const MatrixExpr<R>& B) {
+    return MatrixSum<L, R>(A.self(), B.self(), -1.0);
 }
 
-Matrix tensor2(const Vector& x, const Vector& y) {
-    Matrix w(x.size(), y.size());
-    for (int i = 1; i <= x.size(); ++i)
-        for (int j = 1; j <= y.size(); ++j) w(i, j) = x(i) * y(j);
-    return w;
+template <class E>
+MatrixScaled<E> operator-(const MatrixExpr<E>& A) { return MatrixScaled<E>(A.self(), -1.0); }
+
+template <class E>
+MatrixScaled<E> operator*(const MatrixExpr<E>& A, double c) { return MatrixScaled<E>(A.self(), c); }
+
+template <class E>
+MatrixScaled<E> operator*(double c, const MatrixExpr<E>& A) { return MatrixScaled<E>(A.self(), c); }
+
+template <class L, class R>
+MatrixProduct<L, R> operator*(const MatrixExpr<L>& A, const MatrixExpr<R>& B) {
+    return MatrixProduct<L, R>(A.self(), B.self());
 }
 
+template <class E>
+MatrixTranspose<E> trans(const MatrixExpr<E>& A) { return MatrixTranspose<E>(A.self()); }
+
+template <class L, class R>
+MatrixOuter<L, R> tensor2(const VectorExpr<L>& x, const VectorExpr<R>& y) { return MatrixOuter<L, R>(x.self(), y.self()); }
 
-// Householder transformation (実装は以前と同じ)
+
+// ハウスホルダー変換による上ヘッセンベルグ化 (A を上書き)
+// 鏡像変換 P = I - 2uu^T は作らず, 変化する部分行列のビューに直接 B - 2 u (u^T B), C - 2 (C u) u^T を書き込む
 void householder(Matrix& A) {
     int n = A.row();
-    Vector v(n);
-    Vector x(n);
-    Vector u(n);
-    Matrix P;
-    Matrix H = Matrix(n);
-    Matrix I = Matrix::identity(n);
+    Vector u(n), w(n);
 
     for (int k = 1; k <= n - 2; ++k) {
-        for (int i = 1; i <= n; ++i) x(i) = 0.0;
-        for (int i = k + 1; i <= n; ++i) x(i) = A(i, k);
+        int m = n - k;
+        VectorView x = A.block(k + 1, k, m, 1).col_view(1);
 
         double norm_x = norm(x);
         if (norm_x < 1e-15) continue;
 
-        if (x(k + 1) > 0) {
+        if (x(1) > 0) {
             norm_x = -norm_x;
         }
+        VectorView v = u.segment(1, m);
         v = x;
-        v(k + 1) -= norm_x;
+        v(1) -= norm_x;
 
-        double norm_v_sq = v * v;
-        if (norm_v_sq < 1e-15) continue;
+        double norm_v = norm(v);
+        if (norm_v < 1e-15) continue;
+        v = v / norm_v;
 
-        u = v / sqrt(norm_v_sq);
-        P = I - 2.0 * tensor2(u, u);
+        // 左から: A(k+1..n, k..n) -= 2 v (v^T A(k+1..n, k..n))
+        MatrixView B = A.block(k + 1, k, m, n - k + 1);
+        VectorView wb = w.segment(1, n - k + 1);
+        for (int j = 1; j <= B.col(); ++j) {
+            double sum = 0.0;
+            for (int i = 1; i <= m; ++i) sum += v(i) * B(i, j);
+            wb(j) = sum;
+        }
+        B = B - 2.0 * tensor2(v, wb);
 
-        H = trans(P) * A * P;
-        for (int i = k; i <= n; ++i) {
-            for (int j = k; j <= n; ++j) {
-                A(i, j) = H(i, j);
+        // 右から: A(1..n, k+1..n) -= 2 (A(1..n, k+1..n) v) v^T
+        MatrixView C = A.block(1, k + 1, n, m);
+        VectorView wc = w.segment(1, n);
+        for (int i = 1; i <= n; ++i) {
+            double sum = 0.0;
+            for (int j = 1; j <= m; ++j) sum += C(i, j) * v(j);
+            wc(i) = sum;
+        }
+        C = C - 2.0 * tensor2(wc, v);
+
+        x(1) = norm_x;
+        for (int i = 2; i <= m; ++i) x(i) = 0.0;
+    }
+}
+
+// Francis のダブルシフトQR法の1反復 (H は上ヘッセンベルグ行列のビュー)
+// シフトは和 trace, 積 det の共役な2つで, (H - σ1 I)(H - σ2 I) の第1列から始めた
+// 長さ3の鏡像変換で突起を右下へ追い出し, 実数演算のまま H を直接更新する
+void francis_step(MatrixView H, double trace, double det) {
+    int m = H.row();
+    double x = H(1, 1) * H(1, 1) + H(1, 2) * H(2, 1) - trace * H(1, 1) + det;
+    double y = H(2, 1) * (H(1, 1) + H(2, 2) - trace);
+    double z = m > 2 ? H(2, 1) * H(3, 2) : 0.0;
+    double v[3];
+
+    for (int k = 0; k <= m - 2; ++k) {
+        int r = min(3, m - k);
+        double norm_x = sqrt(x * x + y * y + (r == 3 ? z * z : 0.0));
+        if (norm_x > 0.0) {
+            double alpha = x > 0 ? -norm_x : norm_x;
+            v[0] = x - alpha;
+            v[1] = y;
+            v[2] = r == 3 ? z : 0.0;
+            double beta = 2.0 / (v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+
+            // 左から: 行 k+1..k+r
+            MatrixView B = H.block(k + 1, max(1, k), r, m - max(1, k) + 1);
+            for (int j = 1; j <= B.col(); ++j) {
+                double w = 0.0;
+                for (int i = 1; i <= r; ++i) w += v[i - 1] * B(i, j);
+                w *= beta;
+                for (int i = 1; i <= r; ++i) B(i, j) -= w * v[i - 1];
+            }
+            // 右から: 列 k+1..k+r
+            MatrixView C = H.block(1, k + 1, min(k + r + 1, m), r);
+            for (int i = 1; i <= C.row(); ++i) {
+                double w = 0.0;
+                for (int j = 1; j <= r; ++j) w += C(i, j) * v[j - 1];
+                w *= beta;
+                for (int j = 1; j <= r; ++j) C(i, j) -= w * v[j - 1];
+            }
+            if (k > 0) {
+                H(k + 1, k) = alpha;
+                for (int i = 2; i <= r; ++i) H(k + i, k) = 0.0;
             }
         }
-        for (int i = k + 1; i <= n; ++i) A(k, i) = A(i, k) = (i == k + 1) ? H(k, i) : 0.0;
+        if (k < m - 2) {
+            x = H(k + 2, k + 1);
+            y = H(k + 3, k + 1);
+            z = k + 4 <= m ? H(k + 4, k + 1) : 0.0;
+        }
     }
 }
 
@@ -307,41 +843,232 @@ Vector eigenvalues_qr(Matrix A, int max_iterations = 1000, double tolerance = 1e
 }
 
 
-// ダブルQR法による固有値計算関数 (簡略版 - シフトなし)
+// H(i, i-1) が対角成分に比べて無視できるか
+bool negligible(const MatrixView& H, int i, double tolerance) {
+    return abs(H(i, i - 1)) <= tolerance * (abs(H(i - 1, i - 1)) + abs(H(i, i)))
+           || abs(H(i, i - 1)) < 1e-300;
+}
+
+// 右下の 2x2 のブロックの固有値の和と積 (停滞したら例外シフトに変える)
+void double_shift(const MatrixView& H, int stall, double& trace, double& det) {
+    int m = H.row();
+    double a = H(m - 1, m - 1), b = H(m - 1, m), c = H(m, m - 1), d = H(m, m);
+    if (stall % 11 == 10) {
+        double e = abs(H(m, m - 1)) + abs(H(m - 1, m - 2));
+        trace = 2.0 * d + 1.5 * e;
+        det = (d + 0.75 * e) * (d + 0.75 * e) + 0.4375 * e * e;
+    } else {
+        trace = a + d;
+        det = a * d - b * c;
+    }
+}
+
+// 2x2 のブロックの固有値 (複素数なら実部)
+void eigenvalues_2x2(const MatrixView& H, int i, double& l1, double& l2) {
+    double a = H(i, i), b = H(i, i + 1), c = H(i + 1, i), d = H(i + 1, i + 1);
+    double p = 0.5 * (a - d);
+    double disc = p * p + b * c;
+    double r = disc > 0.0 ? sqrt(disc) : 0.0;
+    l1 = 0.5 * (a + d) + r;
+    l2 = 0.5 * (a + d) - r;
+}
+
+// ダブルQR法による固有値計算関数 (Francis のダブルシフトと収縮つき)
+// 収縮のたびに H の左上の m x m の部分行列のビューだけを更新し, H の複写は行わない
+// 複素固有値の組は 2x2 のブロックとして取り出し, 実部を返す
 Vector eigenvalues_double_qr(Matrix A, int max_iterations = 1000, double tolerance = 1e-10) {
     int n = A.row();
     Vector eigenvalues(n);
-    Matrix H = A;
 
-    householder(H); // ヘッセンベルグ行列への変換 (対称行列でも適用可能)
+    householder(A); // ヘッセンベルグ行列への変換 (A をそのまま H として使う)
 
-    for (int iter = 0; iter < max_iterations; ++iter) {
-        Matrix Q, R;
-        qr_decomposition(H, Q, R); // QR分解
-        H = R * Q; // RQで更新 (ダブルシフトは省略)
+    int m = n;
+    int iter = 0, stall = 0;
+    while (m > 0) {
+        MatrixView H = A.block(1, 1, m, m);
+        if (m == 1) {
+            eigenvalues(1) = H(1, 1);
+            m = 0;
+        } else if (negligible(H, m, tolerance)) {
+            eigenvalues(m) = H(m, m);
+            m -= 1;
+            stall = 0;
+        } else if (m == 2 || negligible(H, m - 1, tolerance)) {
+            eigenvalues_2x2(H, m - 1, eigenvalues(m - 1), eigenvalues(m));
+            m -= 2;
+            stall = 0;
+        } else {
+            if (iter >= max_iterations) break;
+            double trace, det;
+            double_shift(H, ++stall, trace, det);
+            francis_step(H, trace, det);
+            iter++;
+        }
+    }
+    if (m > 0) {
+        cout << "警告: 最大反復回数に達しました" << endl;
+        for (int i = 1; i <= m; ++i) eigenvalues(i) = A(i, i);
+    }
+    return eigenvalues;
+}
 
+// 比較用: dqr-test.cpp と同じく, 反復ごとに有効な部分を一時行列に複写して更新してから書き戻す
+Vector eigenvalues_double_qr_copying(Matrix A, int max_iterations = 1000, double tolerance = 1e-10) {
+    int n = A.row();
+    Vector eigenvalues(n);
 
-        double off_diagonal_norm_sq = 0;
-        for (int i = 1; i <= n; ++i) {
-            for (int j = 1; j <= n; ++j) {
-                if (i != j) {
-                    off_diagonal_norm_sq += H(i, j) * H(i, j);
-                }
-            }
+    householder(A);
+
+    int m = n;
+    int iter = 0, stall = 0;
+    while (m > 0) {
+        MatrixView H = A.block(1, 1, m, m);
+        if (m == 1) {
+            eigenvalues(1) = H(1, 1);
+            m = 0;
+        } else if (negligible(H, m, tolerance)) {
+            eigenvalues(m) = H(m, m);
+            m -= 1;
+            stall = 0;
+        } else if (m == 2 || negligible(H, m - 1, tolerance)) {
+            eigenvalues_2x2(H, m - 1, eigenvalues(m - 1), eigenvalues(m));
+            m -= 2;
+            stall = 0;
+        } else {
+            if (iter >= max_iterations) break;
+            double trace, det;
+            double_shift(H, ++stall, trace, det);
+            Matrix H_shifted(m);
+            H_shifted.view() = H;
+            francis_step(H_shifted.view(), trace, det);
+            Matrix H_new = H_shifted;
+            H = H_new;
+            iter++;
         }
+    }
+    for (int i = 1; i <= m; ++i) eigenvalues(i) = A(i, i);
+    return eigenvalues;
+}
 
+// 式テンプレートの効果を調べる: 同じ式を1回の代入で計算した場合と,
+// 演算ごとに一時行列を作った場合 (ライブラリの Matrix と同じ) のヒープ確保の回数と時間を比べる
+void bench_expressions(int n, int repeat = 20) {
+    Matrix A(n), P(n), H(n);
+    Matrix I = Matrix::identity(n);
+    Vector u(n);
+    srand(1);
+    for (int i = 1; i <= n; ++i) {
+        for (int j = 1; j <= n; ++j) A(i, j) = (double)rand() / RAND_MAX - 0.5;
+    }
+    for (int i = 1; i <= n; ++i) u(i) = (double)rand() / RAND_MAX - 0.5;
+    u = u / norm(u);
 
-        if (sqrt(off_diagonal_norm_sq) < tolerance) {
-            break; // 収束判定 (オフダイアゴナル要素が十分小さい)
-        }
+    cout << "式テンプレートのベンチマーク (n = " << n << ", " << repeat << "回の平均)" << endl;
+
+    long count = allocation_count;
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < repeat; ++r) P = I - 2.0 * tensor2(u, u);
+    double fused_time = chrono::duration<double>(chrono::steady_clock::now() - start).count() / repeat;
+    double fused_count = (double)(allocation_count - count) / repeat;
+
+    Matrix P_temp;
+    count = allocation_count;
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < repeat; ++r) {
+        Matrix T = tensor2(u, u);
+        Matrix S = 2.0 * T;
+        P_temp = Matrix(I - S);
+    }
+    double temp_time = chrono::duration<double>(chrono::steady_clock::now() - start).count() / repeat;
+    double temp_count = (double)(allocation_count - count) / repeat;
+    cout << "  P = I - 2.0 * tensor2(u, u): 一括 " << fused_count << "回 " << fused_time << " 秒, "
+         << "一時行列あり " << temp_count << "回 " << temp_time << " 秒" << endl;
+
+    H = trans(P) * A * P;   // キャッシュを温めておく
+    count = allocation_count;
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < repeat; ++r) H = trans(P) * A * P;
+    fused_time = chrono::duration<double>(chrono::steady_clock::now() - start).count() / repeat;
+    fused_count = (double)(allocation_count - count) / repeat;
+
+    Matrix H_temp;
+    count = allocation_count;
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < repeat; ++r) {
+        Matrix Pt = trans(P);
+        Matrix PA = Pt * A;
+        H_temp = Matrix(PA * P);
     }
+    temp_time = chrono::duration<double>(chrono::steady_clock::now() - start).count() / repeat;
+    temp_count = (double)(allocation_count - count) / repeat;
+    cout << "  H = trans(P) * A * P:        一括 " << fused_count << "回 " << fused_time << " 秒, "
+         << "一時行列あり " << temp_count << "回 " << temp_time << " 秒" << endl;
 
-    // 固有値を抽出 (対角成分から - 複素固有値ペアの処理は省略)
+    double diff = 0.0;
     for (int i = 1; i <= n; ++i) {
-        eigenvalues(i) = H(i, i); // 実部のみ (複素固有値は近似的な実部となる可能性あり)
+        for (int j = 1; j <= n; ++j) diff = max(diff, abs(H(i, j) - H_temp(i, j)));
     }
+    cout << "  結果の差の最大値: " << diff << endl;
 
-    return eigenvalues;
+    // 代入先が右辺に現れる場合 (一時行列に計算してから入れ替える)
+    Matrix B = A;
+    B = trans(B) * B;
+    Matrix C = trans(A) * A;
+    diff = 0.0;
+    for (int i = 1; i <= n; ++i) {
+        for (int j = 1; j <= n; ++j) diff = max(diff, abs(B(i, j) - C(i, j)));
+    }
+    cout << "  B = trans(B) * B の結果の差: " << diff << endl;
+
+    Matrix Ah = A;
+    count = allocation_count;
+    start = chrono::steady_clock::now();
+    householder(Ah);
+    cout << "  householder: " << allocation_count - count << "回 "
+         << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " 秒" << endl;
+}
+
+
+// 部分行列のビューの効果を調べる: 収縮した部分をビューで直接更新する場合と,
+// 反復ごとに複写する場合のヒープ確保の回数と時間, 記憶領域の境界を比べる
+void bench_views(int n) {
+    Matrix A(n);
+    srand(2);
+    for (int i = 1; i <= n; ++i) {
+        for (int j = 1; j <= n; ++j) A(i, j) = (double)rand() / RAND_MAX - 0.5;
+    }
+
+    cout << "部分行列のビューのベンチマーク (n = " << n << ")" << endl;
+    cout << "  data() の 64 バイト境界: " << (reinterpret_cast<uintptr_t>(A.data()) % storage_alignment == 0 ? "揃っている" : "揃っていない") << endl;
+
+    eigenvalues_double_qr(A);   // キャッシュを温めておく
+    long count = allocation_count;
+    auto start = chrono::steady_clock::now();
+    Vector view_result = eigenvalues_double_qr(A);
+    double view_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    long view_count = allocation_count - count;
+
+    count = allocation_count;
+    start = chrono::steady_clock::now();
+    Vector copy_result = eigenvalues_double_qr_copying(A);
+    double copy_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    long copy_count = allocation_count - count;
+
+    double diff = 0.0;
+    for (int i = 1; i <= n; ++i) diff = max(diff, abs(view_result(i) - copy_result(i)));
+    cout << "  eigenvalues_double_qr: ビュー " << view_count << "回 " << view_time << " 秒, "
+         << "複写あり " << copy_count << "回 " << copy_time << " 秒" << endl;
+    cout << "  結果の差の最大値: " << diff << endl;
+
+    // ビューへの代入と転置のビュー
+    Matrix B = A;
+    B.block(1, 1, n / 2, n / 2) = 2.0 * A.block(1, 1, n / 2, n / 2);
+    Matrix T = A.transpose_view();
+    diff = abs(B(1, 1) - 2.0 * A(1, 1));
+    for (int i = 1; i <= n; ++i) {
+        for (int j = 1; j <= n; ++j) diff = max(diff, abs(T(i, j) - A(j, i)));
+    }
+    cout << "  ビューへの代入と転置の差: " << diff << endl;
 }
 
 
@@ -356,10 +1083,13 @@ int main() {
     cout << "元の行列 A:" << endl;
     cout << A << endl;
 
-    Vector eigenvalues = eigenvalues_double_qr(A); // ダブルQR法を使用 (簡易版)
-    cout << "固有値 (ダブルQR法 - 簡易版):" << endl;
+    Vector eigenvalues = eigenvalues_double_qr(A); // ダブルQR法を使用
+    cout << "固有値 (ダブルQR法):" << endl;
     cout << eigenvalues << endl;
 
+    bench_expressions(100);
+    bench_views(100);
+
     // stop(); // stop() はコメントアウトまたは削除。exit(0) や return 0 で代替可能
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,893 @@
+#include "../pch.h"
+#include "eigenvalue_methods.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <cstdlib>
+#include <new>
+using namespace std;
+
+// ヒープ確保の回数を数えるための operator new の置き換え
+static long allocation_count = 0;
+
+void* operator new(size_t size) {
+    allocation_count++;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+// ベンチマークのパラメータ
+namespace params {
+    const int sizes[] = {100, 300, 1000};   // 行列のサイズ
+    const int textbook_max_size = 100;      // O(n^4) の素朴な実装を計測する最大サイズ
+    const int power_sizes[] = {100, 1000};  // べき乗法を測る行列のサイズ
+    const double power_seconds = 0.5;       // べき乗法の計測時間の目安 [秒]
+    const int batch_size = 1000;            // 複数シフトの逆反復法を測る行列のサイズ
+    const int batch_shifts = 200;           // シフトの数
+    const int batch_single = 5;             // 1つずつ逆反復法を呼んで時間を測るシフトの数
+    const int operator_size = 2000;         // 密行列と疎行列の作用素でべき乗法を比べる行列のサイズ
+    const int sparse_grid = 316;            // 疎行列の格子の一辺 (n = sparse_grid^2, 約10万)
+    const int spmv_repeat = 50;             // 疎行列ベクトル積の計測回数
+    const int krylov_sizes[] = {2000, 20000};  // Krylov 部分空間法で扱う疎行列のサイズ
+    const int refine_size = 300;            // 逆反復法で固有対を精密化する行列のサイズ
+    const int refine_count = 100;           // 精密化する固有対の数
+    const double refine_offset = 0.1;       // 初期シフトと固有値のずれ (隣の固有値との間隔に対する比)
+    const int krylov_k = 6;                 // Krylov 部分空間法で求める固有値の数
+    const int gemm_sizes[] = {64, 128, 256, 512, 1024, 2048, 4096};  // 行列積を測る行列のサイズ
+    const int gemm_naive_max = 1024;        // Matrix::operator* (3重ループ) を測る最大サイズ
+    const int gemm_scalar_max = 2048;       // スカラーのカーネルを測る最大サイズ
+    const double gemm_seconds = 0.2;        // 行列積の計測時間の目安 [秒]
+    const int scaling_size = 2000;          // 並列化の強スケーリングを測る行列のサイズ
+    const int scaling_threads[] = {1, 2, 4, 8, 16, 32, 64};  // 強スケーリングを測るスレッド数
+    const int small_repeat = 1000000;       // 3x3 の行列ベクトル積の計測回数
+    const int small_batch = 1000000;        // まとめて解く小さな固有値問題の数
+    const int small_library = 20000;        // Matrix と compute_eigenvalues で1つずつ解く小さな固有値問題の数
+    const int solver_sizes[] = {50, 200};   // EigenSolver を使い回して解き直す行列のサイズ
+    const int solver_steps = 100;           // 解き直すステップの数
+    const double solver_drift = 1e-6;       // ステップごとに対角要素へ加える変化
+    const unsigned seed = 1;                // 乱数の種
+}
+
+// [-0.5, 0.5) の一様乱数を要素とする非対称行列
+Matrix random_matrix(int n) {
+    Matrix A(n);
+    for (int i = 1; i <= n; ++i) {
+        for (int j = 1; j <= n; ++j) {
+            A(i, j) = rand() / (RAND_MAX + 1.0) - 0.5;
+        }
+    }
+    return A;
+}
+
+bool complex_less(const complex<double>& a, const complex<double>& b) {
+    if (a.real() != b.real()) return a.real() < b.real();
+    return a.imag() < b.imag();
+}
+
+// 経過時間 [秒]
+double seconds_since(const chrono::steady_clock::time_point& start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// [-0.5, 0.5) の一様乱数を要素とする対称行列
+Matrix random_symmetric_matrix(int n) {
+    Matrix A(n);
+    for (int i = 1; i <= n; ++i) {
+        for (int j = 1; j <= i; ++j) {
+            A(i, j) = A(j, i) = rand() / (RAND_MAX + 1.0) - 0.5;
+        }
+    }
+    return A;
+}
+
+// 鏡像変換行列 P = I - 2uu^T を陽に作り P^T A P を計算する素朴なヘッセンベルグ化 (O(n^4))
+void householder_textbook(Matrix& A) {
+    int n = A.row();
+    Matrix I(n);
+    for (int i = 1; i <= n; ++i) I(i, i) = 1.0;
+    
+    for (int k = 1; k <= n - 2; ++k) {
+        Vector x(n);
+        for (int i = k + 1; i <= n; ++i) x(i) = A(i, k);
+        
+        double norm_x = norm(x);
+        if (norm_x < 1e-15) continue;
+        if (x(k + 1) > 0) norm_x = -norm_x;
+        
+        Vector v = x;
+        v(k + 1) -= norm_x;
+        double norm_v_sq = v * v;
+        if (norm_v_sq < 1e-15) continue;
+        
+        Vector u = v / sqrt(norm_v_sq);
+        Matrix P = I - 2.0 * tensor2(u, u);
+        A = trans(P) * A * P;
+        for (int i = k + 2; i <= n; ++i) A(i, k) = 0.0;
+    }
+}
+
+// フロベニウスノルム (相似変換の前後で保存される)
+double frobenius_norm(const Matrix& A) {
+    double sum = 0.0;
+    for (int i = 1; i <= A.row(); ++i) {
+        for (int j = 1; j <= A.col(); ++j) sum += A(i, j) * A(i, j);
+    }
+    return sqrt(sum);
+}
+
+// ヘッセンベルグ化の実装ごとの実行時間を比較する
+void bench_hessenberg(int n) {
+    Matrix A = random_matrix(n);
+    double norm_A = frobenius_norm(A);
+    
+    if (n <= params::textbook_max_size) {
+        Matrix H = A;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        householder_textbook(H);
+        cout << "  " << setw(8) << "Textbook" << "  時間 = " << setw(8) << fixed << setprecision(3)
+             << seconds_since(start) << " s" << endl;
+    }
+    
+    {
+        Matrix H = A;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        hess(H);
+        cout << "  " << setw(8) << "hess" << "  時間 = " << setw(8) << fixed << setprecision(3)
+             << seconds_since(start) << " s" << endl;
+    }
+    
+    const int block_sizes[] = {1, 32};
+    for (int b = 0; b < 2; ++b) {
+        Matrix H = A;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        hessenberg_reduction(H, nullptr, block_sizes[b]);
+        double elapsed = seconds_since(start);
+        cout << "  " << setw(8) << (b == 0 ? "Unblock" : "Blocked") << "  時間 = " << setw(8)
+             << fixed << setprecision(3) << elapsed << " s"
+             << "  ノルムの差 = " << scientific << setprecision(2) << abs(frobenius_norm(H) - norm_A) << endl;
+    }
+}
+
+// QR法の反復戦略ごとの反復回数と実行時間を比較する
+void bench_qr_strategies(int n) {
+    Matrix A = random_matrix(n);
+    const QRStrategy strategies[] = {QR_FRANCIS, QR_AED, QR_MULTISHIFT};
+    const char* names[] = {"Francis", "AED", "Multi"};
+    vector<complex<double>> reference;
+    
+    for (int s = 0; s < 3; ++s) {
+        vector<int> iterations;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        vector<complex<double>> eigenvals = eigenvalues_double_qr(A, 200, 1e-12, &iterations, strategies[s]);
+        double elapsed = seconds_since(start);
+        
+        long total = 0;
+        for (size_t i = 0; i < iterations.size(); ++i) total += iterations[i];
+        
+        sort(eigenvals.begin(), eigenvals.end(), complex_less);
+        double diff = 0.0;
+        if (s == 0) {
+            reference = eigenvals;
+        } else {
+            for (size_t i = 0; i < eigenvals.size() && i < reference.size(); ++i) {
+                diff = max(diff, abs(eigenvals[i] - reference[i]));
+            }
+        }
+        
+        cout << "  " << setw(8) << names[s]
+             << "  平均反復回数 = " << setw(6) << fixed << setprecision(2) << (double)total / n
+             << "  時間 = " << setw(8) << setprecision(3) << elapsed << " s";
+        if (s > 0) cout << "  Francisとの差 = " << scientific << setprecision(2) << diff;
+        cout << endl;
+    }
+}
+
+// 対称行列での一般のQR法と対称三重対角の経路の比較
+void bench_symmetric(int n) {
+    Matrix A = random_symmetric_matrix(n);
+    
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<complex<double>> general = eigenvalues_double_qr(A);
+    double time_general = seconds_since(start);
+    
+    start = chrono::steady_clock::now();
+    vector<double> values = eigenvalues_symmetric(A);
+    double time_values = seconds_since(start);
+    
+    Matrix V;
+    start = chrono::steady_clock::now();
+    eigenvalues_symmetric(A, &V);
+    double time_vectors = seconds_since(start);
+    
+    vector<double> general_real;
+    for (size_t i = 0; i < general.size(); ++i) general_real.push_back(general[i].real());
+    sort(general_real.begin(), general_real.end());
+    double diff = 0.0;
+    for (size_t i = 0; i < values.size() && i < general_real.size(); ++i) {
+        diff = max(diff, abs(values[i] - general_real[i]));
+    }
+    
+    cout << "  " << setw(8) << "General" << "  時間 = " << setw(8) << fixed << setprecision(3) << time_general << " s" << endl;
+    cout << "  " << setw(8) << "Sym" << "  時間 = " << setw(8) << time_values << " s"
+         << "  一般のQR法との差 = " << scientific << setprecision(2) << diff << endl;
+    cout << "  " << setw(8) << "Sym+vec" << "  時間 = " << setw(8) << fixed << setprecision(3) << time_vectors << " s" << endl;
+}
+
+// 反復ごとに Vector を確保する従来のべき乗法 (途中経過の表示を除いたもの)
+int power_method_allocating(const Matrix& A, double& eigenval, Vector& eigenvec,
+                            int max_iterations, double tolerance) {
+    int n = A.row();
+    Vector x(n), x_new(n);
+    for (int i = 1; i <= n; i++) x(i) = 1.0;
+    normalize(x);
+    
+    for (int iter = 0; iter < max_iterations; iter++) {
+        x_new = A * x;
+        double lambda = norm(x_new);
+        x_new = x_new / lambda;
+        if (norm(x_new - x) < tolerance) {
+            eigenval = lambda;
+            eigenvec = x_new;
+            return iter + 1;
+        }
+        x = x_new;
+    }
+    eigenval = norm(A * x);
+    eigenvec = x;
+    return max_iterations;
+}
+
+// べき乗法の1反復あたりの時間とヒープ確保回数の比較
+void bench_power(int n) {
+    // 非負の乱数行列 (最大固有値が孤立していて数十回で収束する)
+    Matrix A(n);
+    for (int i = 1; i <= n; ++i) {
+        for (int j = 1; j <= n; ++j) A(i, j) = rand() / (RAND_MAX + 1.0);
+    }
+    
+    double eigenval_alloc = 0.0, eigenval_work = 0.0;
+    Vector eigenvec(n);
+    PowerWorkspace work;
+    
+    for (int s = 0; s < 2; ++s) {
+        long iterations = 0, calls = 0;
+        long allocations = allocation_count;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        double elapsed = 0.0;
+        while (elapsed < params::power_seconds) {
+            if (s == 0) iterations += power_method_allocating(A, eigenval_alloc, eigenvec, 100, 1e-10);
+            else iterations += power_method(A, eigenval_work, eigenvec, work, 100, 1e-10);
+            calls++;
+            elapsed = seconds_since(start);
+        }
+        allocations = allocation_count - allocations;
+        
+        cout << "  " << setw(8) << (s == 0 ? "Vector" : "Work")
+             << "  1反復 = " << setw(8) << fixed << setprecision(3) << 1e6 * elapsed / iterations << " us"
+             << "  確保回数/反復 = " << setw(6) << setprecision(2) << (double)allocations / iterations
+             << "  (" << calls << "回呼び出し)";
+        if (s == 1) cout << "  固有値の差 = " << scientific << setprecision(2) << abs(eigenval_work - eigenval_alloc);
+        cout << endl;
+    }
+}
+
+// 行列積の GFLOP/s: Matrix::operator* (3重ループ) と gemm (gemm.h) のカーネルごとの比較
+void bench_gemm(int n) {
+    Matrix A = random_matrix(n), B = random_matrix(n);
+    vector<double> a((size_t)n * n), b((size_t)n * n), c((size_t)n * n);
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            a[(size_t)i * n + j] = A(i+1, j+1);
+            b[(size_t)i * n + j] = B(i+1, j+1);
+        }
+    }
+    double flops = 2.0 * n * n * (double)n;
+    
+    Matrix C;
+    cout << "  " << setw(10) << "operator*";
+    if (n <= params::gemm_naive_max) {
+        int calls = 0;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        double elapsed = 0.0;
+        while (elapsed < params::gemm_seconds) {
+            C = A * B;
+            calls++;
+            elapsed = seconds_since(start);
+        }
+        cout << "  " << setw(7) << fixed << setprecision(2) << flops * calls / elapsed * 1e-9 << " GFLOP/s" << endl;
+    } else {
+        cout << "  (省略)" << endl;
+    }
+    
+    const GemmKernel kernels[] = {GEMM_SCALAR, GEMM_AVX2, GEMM_AVX512};
+    for (int s = 0; s < 3; ++s) {
+        cout << "  " << setw(10) << gemm_kernel_name(kernels[s]);
+        if (!gemm_kernel_available(kernels[s])) {
+            cout << "  (この CPU では使えない)" << endl;
+            continue;
+        }
+        if (kernels[s] == GEMM_SCALAR && n > params::gemm_scalar_max) {
+            cout << "  (省略)" << endl;
+            continue;
+        }
+        int calls = 0;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        double elapsed = 0.0;
+        while (elapsed < params::gemm_seconds) {
+            gemm(n, n, n, &a[0], n, &b[0], n, &c[0], n, false, kernels[s]);
+            calls++;
+            elapsed = seconds_since(start);
+        }
+        double diff = 0.0;
+        if (n <= params::gemm_naive_max) {
+            for (int i = 0; i < n; ++i) {
+                for (int j = 0; j < n; ++j) diff = max(diff, abs(c[(size_t)i * n + j] - C(i+1, j+1)));
+            }
+        }
+        cout << "  " << setw(7) << fixed << setprecision(2) << flops * calls / elapsed * 1e-9 << " GFLOP/s";
+        if (n <= params::gemm_naive_max) cout << "  operator* との差 = " << scientific << setprecision(2) << diff;
+        cout << endl;
+    }
+}
+
+// 共有スレッドプールで並列化した行列演算の強スケーリング (同じ大きさの問題をスレッド数を変えて解く)
+void bench_scaling(int n) {
+    Matrix A = random_matrix(n), B = random_matrix(n), C, At;
+    Vector x(n), y;
+    for (int i = 1; i <= n; ++i) x(i) = rand() / (RAND_MAX + 1.0);
+    
+    double base[5] = {};
+    for (size_t t = 0; t < sizeof(params::scaling_threads) / sizeof(params::scaling_threads[0]); ++t) {
+        int threads = params::scaling_threads[t];
+        if (threads > 1 && threads > (int)thread::hardware_concurrency()) break;
+        set_parallel_options(threads);
+        
+        double times[5];
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        matrix_multiply(A, B, C);
+        times[0] = seconds_since(start);
+        
+        start = chrono::steady_clock::now();
+        for (int r = 0; r < 10; ++r) matrix_vector_multiply(A, x, y);
+        times[1] = seconds_since(start) / 10;
+        
+        start = chrono::steady_clock::now();
+        transpose(A, At);
+        times[2] = seconds_since(start);
+        
+        start = chrono::steady_clock::now();
+        for (int r = 0; r < 10; ++r) matrix_norm(A);
+        times[3] = seconds_since(start) / 10;
+        
+        start = chrono::steady_clock::now();
+        for (int r = 0; r < 10; ++r) residual_norm(A, x, 1.0);
+        times[4] = seconds_since(start) / 10;
+        
+        if (t == 0) copy(times, times + 5, base);
+        const char* names[] = {"A*B", "A*x", "trans", "norm", "残差"};
+        cout << "  " << setw(3) << threads << " スレッド";
+        for (int k = 0; k < 5; ++k) {
+            cout << "  " << names[k] << " = " << fixed << setprecision(4) << times[k] << " s (x"
+                 << setprecision(2) << base[k] / times[k] << ")";
+        }
+        cout << endl;
+    }
+    
+    // 閾値未満の小さな行列は呼んだスレッドだけで計算する
+    set_parallel_options(0);
+    Matrix S(3);
+    S = 4.0, -2.0, 0.0,
+       -2.0,  4.0, -2.0,
+        0.0, -2.0,  4.0;
+    Vector s(3), t;
+    s(1) = 1.0; s(2) = 2.0; s(3) = 3.0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int r = 0; r < params::small_repeat; ++r) matrix_vector_multiply(S, s, t);
+    cout << "  3x3 の行列ベクトル積 (" << thread::hardware_concurrency() << " スレッドのプール) = " << fixed
+         << setprecision(1) << 1e9 * seconds_since(start) / params::small_repeat << " ns" << endl;
+}
+
+// 近似固有値から多数の固有対を精密化するときの, 固定シフトの逆反復法とレイリー商反復の比較
+void bench_refine(int n) {
+    Matrix A = random_symmetric_matrix(n);
+    vector<double> exact = eigenvalues_symmetric(A);
+    int stride = max(1, n / params::refine_count);
+    
+    const InverseIterationMode modes[] = {INVERSE_FIXED_SHIFT, INVERSE_RAYLEIGH};
+    const char* names[] = {"Fixed", "RQI"};
+    for (int m = 0; m < 2; ++m) {
+        int iterations = 0, pairs = 0;
+        double error = 0.0;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (int i = 0; i + 1 < n; i += stride) {
+            double value;
+            Vector eigenvector;
+            double seed = exact[i] + params::refine_offset * (exact[i+1] - exact[i]);
+            iterations += inverse_power_method(A, seed, value, eigenvector, modes[m]);
+            error = max(error, abs(value - exact[i]));
+            pairs++;
+        }
+        double time = seconds_since(start);
+        cout << "  " << setw(8) << names[m] << "  時間 = " << setw(8) << fixed << setprecision(3) << time << " s"
+             << "  平均反復回数 = " << setw(6) << setprecision(2) << (double)iterations / pairs
+             << "  誤差 = " << scientific << setprecision(2) << error << endl;
+    }
+}
+
+// 毎ステップ少しずつ変わる行列を解き直すとき, 関数を呼ぶ場合 (Function) と EigenSolver を使い回す場合 (Solver) の
+// 1ステップあたりの時間, ヒープ確保回数と LU 分解の回数. 行列が変わらなければ (Fixed A) 分解は1回で済む
+void bench_solver(int n) {
+    Matrix A = random_symmetric_matrix(n);
+    vector<double> exact = eigenvalues_symmetric(A);
+    double shift = exact[n / 2] + params::refine_offset * (exact[n / 2 + 1] - exact[n / 2]);
+    
+    const char* names[] = {"Function", "Solver", "Fixed A"};
+    EigenSolver solver;
+    for (int s = 0; s < 3; ++s) {
+        Matrix B = A;
+        Vector eigenvector(n);
+        double value = 0.0;
+        vector<complex<double>> values;
+        long factorizations = solver.factorizations(), allocations = 0;
+        double inverse_time = 0.0, qr_time = 0.0;
+        for (int step = 0; step <= params::solver_steps; ++step) {
+            if (s != 2) {
+                for (int i = 1; i <= n; ++i) B(i, i) += params::solver_drift;
+            }
+            // 最初のステップは作業領域を確保するので数えない
+            long count = allocation_count;
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            for (int i = 1; i <= n; ++i) eigenvector(i) = 0.0;
+            if (s == 0) inverse_power_method(B, shift, value, eigenvector, INVERSE_FIXED_SHIFT);
+            else solver.inverse_power_method(B, shift, value, eigenvector);
+            double t = seconds_since(start);
+            start = chrono::steady_clock::now();
+            if (s == 0) values = eigenvalues_double_qr(B);
+            else solver.eigenvalues_double_qr(B);
+            if (step > 0) {
+                inverse_time += t;
+                qr_time += seconds_since(start);
+                allocations += allocation_count - count;
+            }
+        }
+        cout << "  " << setw(8) << names[s]
+             << "  逆反復 = " << setw(7) << fixed << setprecision(3) << 1e3 * inverse_time / params::solver_steps << " ms"
+             << "  QR法 = " << setw(7) << 1e3 * qr_time / params::solver_steps << " ms"
+             << "  確保回数/ステップ = " << setw(6) << setprecision(2) << (double)allocations / params::solver_steps;
+        if (s > 0) cout << "  LU 分解 = " << solver.factorizations() - factorizations << "回";
+        cout << "  固有値の誤差 = " << scientific << setprecision(2)
+             << abs(value - exact[n / 2] - (s == 2 ? 0.0 : params::solver_drift * (params::solver_steps + 1))) << endl;
+    }
+}
+
+// 複数のシフトに対する逆反復法: 1つずつ inverse_power_method を呼ぶ (毎回 O(n^3) の LU 分解) のと,
+// 1回の縮約を共有する inverse_iteration_batch (1スレッドと全スレッド) の比較
+void bench_batch(int n, bool symmetric) {
+    Matrix A = symmetric ? random_symmetric_matrix(n) : random_matrix(n);
+    vector<double> shifts;
+    if (symmetric) {
+        vector<double> exact = eigenvalues_symmetric(A);
+        int stride = max(1, n / params::batch_shifts);
+        for (int i = 0; i < n && (int)shifts.size() < params::batch_shifts; i += stride) shifts.push_back(exact[i] + 1e-6);
+    } else {
+        vector<complex<double>> exact = eigenvalues_double_qr(A);
+        for (size_t i = 0; i < exact.size() && (int)shifts.size() < params::batch_shifts; ++i) {
+            if (exact[i].imag() == 0.0) shifts.push_back(exact[i].real() + 1e-6);
+        }
+    }
+    int count = shifts.size();
+    
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    int single = min(count, params::batch_single);
+    for (int i = 0; i < single; ++i) {
+        double value;
+        Vector eigenvector;
+        inverse_power_method(A, shifts[i], value, eigenvector, INVERSE_FIXED_SHIFT);
+    }
+    double time_single = seconds_since(start) / single * count;
+    
+    cout << "  " << (symmetric ? "対称" : "非対称") << " (シフト " << count << " 個)" << endl;
+    cout << "  " << setw(8) << "Single" << "  時間 = " << setw(8) << fixed << setprecision(3) << time_single
+         << " s (" << single << " 個から推定)" << endl;
+    
+    int threads_list[] = {1, (int)thread::hardware_concurrency()};
+    for (int t = 0; t < 2; ++t) {
+        if (t == 1 && threads_list[1] <= 1) break;
+        ThreadPool pool(threads_list[t]);
+        vector<double> values;
+        Matrix vectors;
+        start = chrono::steady_clock::now();
+        int iterations = inverse_iteration_batch(A, shifts, values, vectors, &pool);
+        double time = seconds_since(start);
+        cout << "  " << setw(5) << "Batch" << setw(3) << threads_list[t] << "  時間 = " << setw(8) << fixed << setprecision(3) << time
+             << " s  最大反復回数 = " << iterations << endl;
+    }
+}
+
+// 同じ三重対角行列を密行列 (Matrix) と疎行列 (SparseMatrix) で持ったときのべき乗法
+void bench_operator(int n) {
+    vector<Triplet> triplets;
+    for (int i = 1; i <= n; ++i) {
+        Triplet diag = {i, i, 1.0 + 10.0 / i};
+        triplets.push_back(diag);
+        if (i > 1) {
+            Triplet lower = {i, i - 1, 0.5};
+            triplets.push_back(lower);
+        }
+        if (i < n) {
+            Triplet upper = {i, i + 1, 0.5};
+            triplets.push_back(upper);
+        }
+    }
+    SparseMatrix S(n, triplets);
+    Matrix A(n);
+    for (size_t t = 0; t < triplets.size(); ++t) A(triplets[t].row, triplets[t].col) = triplets[t].value;
+    
+    PowerWorkspace work;
+    double dense_value, sparse_value;
+    Vector eigenvector;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    int dense_iterations = power_method(A, dense_value, eigenvector, work, 1000, 1e-10);
+    double time_dense = seconds_since(start);
+    
+    start = chrono::steady_clock::now();
+    int sparse_iterations = power_method(S, sparse_value, eigenvector, work, 1000, 1e-10);
+    double time_sparse = seconds_since(start);
+    
+    double dense_bytes = 8.0 * n * n;
+    double sparse_bytes = 12.0 * S.nonzeros() + 4.0 * (n + 1);
+    cout << "  " << setw(8) << "Matrix" << "  時間 = " << setw(8) << fixed << setprecision(3) << time_dense << " s"
+         << "  反復 = " << setw(4) << dense_iterations << "  行列 = " << setw(8) << setprecision(2) << dense_bytes / 1048576.0 << " MB" << endl;
+    cout << "  " << setw(8) << "Sparse" << "  時間 = " << setw(8) << setprecision(3) << time_sparse << " s"
+         << "  反復 = " << setw(4) << sparse_iterations << "  行列 = " << setw(8) << setprecision(2) << sparse_bytes / 1048576.0 << " MB"
+         << "  固有値の差 = " << scientific << abs(dense_value - sparse_value) << endl;
+}
+
+// 格子状の疎行列 (CSR) での積, Lanczos 法, GMRES による逆反復法
+// 対角要素 1 + 10/i, 格子の上下左右の結合 0.1 (5点差分の形) で, 大きい固有値は対角に近く分離している
+void bench_sparse(int m) {
+    int n = m * m;
+    vector<Triplet> triplets;
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < m; ++j) {
+            int r = i * m + j + 1;
+            Triplet diag = {r, r, 1.0 + 10.0 / r};
+            triplets.push_back(diag);
+            int neighbors[4] = {i > 0 ? r - m : 0, i < m - 1 ? r + m : 0, j > 0 ? r - 1 : 0, j < m - 1 ? r + 1 : 0};
+            for (int k = 0; k < 4; ++k) {
+                if (neighbors[k] == 0) continue;
+                Triplet coupling = {r, neighbors[k], 0.1};
+                triplets.push_back(coupling);
+            }
+        }
+    }
+    SparseMatrix S(n, triplets);
+    cout << "  非零要素 = " << S.nonzeros() << "  行列 = " << fixed << setprecision(2)
+         << (12.0 * S.nonzeros() + 4.0 * (n + 1)) / 1048576.0 << " MB (密行列 " << 8.0 * n * n / 1073741824.0 << " GB)" << endl;
+    
+    // 積 (1スレッドと全スレッド)
+    vector<double> x(n, 1.0), y(n);
+    int threads_list[] = {1, (int)thread::hardware_concurrency()};
+    for (int t = 0; t < 2; ++t) {
+        if (t == 1 && threads_list[1] <= 1) break;
+        ThreadPool pool(threads_list[t]);
+        S.set_thread_pool(&pool);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (int r = 0; r < params::spmv_repeat; ++r) S.apply(&x[0], &y[0]);
+        double time = seconds_since(start) / params::spmv_repeat;
+        cout << "  " << setw(5) << "SpMV" << setw(3) << threads_list[t] << "  1回 = " << setw(8) << setprecision(3) << time * 1e3 << " ms"
+             << "  (" << setprecision(2) << 2.0 * S.nonzeros() / time * 1e-9 << " GFLOP/s)" << endl;
+        S.set_thread_pool(nullptr);
+    }
+    
+    vector<complex<double>> values;
+    KrylovInfo info;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    krylov_eigenvalues(S, 4, true, values, nullptr, nullptr, &info);
+    double time = seconds_since(start);
+    cout << "  " << setw(8) << "Lanczos" << "  時間 = " << setw(8) << setprecision(3) << time << " s  積 = " << info.matvecs
+         << "  λ_max = " << setprecision(6) << values[0].real() << endl;
+    
+    // 4番目に大きい固有値の近くからレイリー商反復 (連立方程式は GMRES で解く)
+    double value;
+    Vector eigenvector;
+    start = chrono::steady_clock::now();
+    int iterations = inverse_power_method(S, values[3].real() + 0.01, value, eigenvector, INVERSE_RAYLEIGH, 50, 1e-10);
+    time = seconds_since(start);
+    cout << "  " << setw(8) << "RQI" << "  時間 = " << setw(8) << setprecision(3) << time << " s  ";
+    if (iterations < 0) {
+        cout << "連立方程式が解けませんでした" << endl;
+        return;
+    }
+    cout << "反復 = " << iterations << "  λ = " << setprecision(6) << value << " (Lanczos " << values[3].real() << ")" << endl;
+}
+
+// 行列を作らずに積だけを与える大規模な三重対角行列での Lanczos 法 / Arnoldi 法
+// 対角要素 1 + 10/i, 上の副対角 0.5, 下の副対角は symmetric なら 0.5, そうでなければ -0.3
+void bench_krylov(int n, bool symmetric) {
+    double lower = symmetric ? 0.5 : -0.3;
+    MatVec matvec = [n, lower](const double* x, double* y) {
+        for (int i = 0; i < n; ++i) {
+            double sum = (1.0 + 10.0 / (i + 1)) * x[i];
+            if (i > 0) sum += lower * x[i-1];
+            if (i < n - 1) sum += 0.5 * x[i+1];
+            y[i] = sum;
+        }
+    };
+    
+    vector<complex<double>> values;
+    Matrix vr, vi;
+    KrylovInfo info;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    krylov_eigenvalues(matvec, n, params::krylov_k, symmetric, values, &vr, &vi, &info);
+    double time = seconds_since(start);
+    
+    // 実固有対の残差 ||A x - λ x|| / ||x||
+    double residual = 0.0;
+    vector<double> x(n), y(n);
+    for (size_t k = 0; k < values.size(); ++k) {
+        if (values[k].imag() != 0.0) continue;
+        double xnorm = 0.0, rnorm = 0.0;
+        for (int i = 0; i < n; ++i) {
+            x[i] = vr(i+1, k+1);
+            xnorm += x[i] * x[i];
+        }
+        matvec(&x[0], &y[0]);
+        for (int i = 0; i < n; ++i) rnorm += (y[i] - values[k].real() * x[i]) * (y[i] - values[k].real() * x[i]);
+        residual = max(residual, sqrt(rnorm / xnorm));
+    }
+    
+    cout << "  " << setw(8) << (symmetric ? "Lanczos" : "Arnoldi") << "  時間 = " << setw(8) << fixed << setprecision(3) << time << " s"
+         << "  再出発 = " << setw(3) << info.restarts << "  積 = " << setw(5) << info.matvecs
+         << "  作業領域 = " << setw(8) << setprecision(2) << info.workspace_bytes / 1048576.0 << " MB"
+         << " (密行列 " << 8.0 * n * n / 1048576.0 << " MB)"
+         << "  残差 = " << scientific << setprecision(2) << residual << endl;
+    cout << "           λ =";
+    for (size_t k = 0; k < values.size(); ++k) {
+        cout << " " << fixed << setprecision(6) << values[k].real();
+        if (values[k].imag() != 0.0) cout << showpos << values[k].imag() << noshowpos << "i";
+    }
+    cout << endl;
+}
+
+// 小さな固有値問題を, Matrix に入れて一般の大きさの経路 (eigenvalues_double_qr, eigenvalues_symmetric) で解く場合,
+// compute_eigenvalues で1つずつ解く場合 (n <= 4 は内部で SmallMatrix に写す. 文字列版と EigenMethod 版) と,
+// SmallMatrix の配列を small_eigenvalues_batch でまとめて解く場合の1秒あたりの個数
+template <int N>
+void bench_small(bool symmetric) {
+    vector<SmallMatrix<N> > batch(params::small_batch);
+    for (int k = 0; k < params::small_batch; ++k) {
+        for (int i = 1; i <= N; ++i) {
+            for (int j = 1; j <= N; ++j) batch[k](i, j) = rand() / (RAND_MAX + 1.0) - 0.5;
+        }
+        if (symmetric) {
+            for (int i = 1; i <= N; ++i) {
+                for (int j = 1; j < i; ++j) batch[k](i, j) = batch[k](j, i);
+            }
+        }
+    }
+    
+    Matrix A(N);
+    vector<complex<double> > vals;
+    double diff = 0.0;
+    long count = allocation_count;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int k = 0; k < params::small_library; ++k) {
+        for (int i = 1; i <= N; ++i) {
+            for (int j = 1; j <= N; ++j) A(i, j) = batch[k](i, j);
+        }
+        vals = compute_eigenvalues(A, symmetric ? "symmetric" : "qr");
+    }
+    double library_rate = params::small_library / seconds_since(start);
+    double library_alloc = (double)(allocation_count - count) / params::small_library;
+    
+    // 列挙型で方法を選び, 呼び出し側の配列に受け取る版 (文字列の比較と結果の vector の確保がない)
+    double re[N], im[N];
+    count = allocation_count;
+    start = chrono::steady_clock::now();
+    for (int k = 0; k < params::small_library; ++k) {
+        for (int i = 1; i <= N; ++i) {
+            for (int j = 1; j <= N; ++j) A(i, j) = batch[k](i, j);
+        }
+        compute_eigenvalues(A, symmetric ? EIG_SYMMETRIC : EIG_QR, re, im);
+    }
+    double typed_rate = params::small_library / seconds_since(start);
+    double typed_alloc = (double)(allocation_count - count) / params::small_library;
+    
+    // 大きさによらない経路 (三重対角化 / ヘッセンベルグ化と QR 法)
+    start = chrono::steady_clock::now();
+    for (int k = 0; k < params::small_library; ++k) {
+        for (int i = 1; i <= N; ++i) {
+            for (int j = 1; j <= N; ++j) A(i, j) = batch[k](i, j);
+        }
+        if (symmetric) {
+            eigenvalues_symmetric(A);
+        } else {
+            vals = eigenvalues_double_qr(A);
+        }
+    }
+    double general_rate = params::small_library / seconds_since(start);
+    
+    vector<complex<double> > lambda((size_t)params::small_batch * N);
+    vector<double> lambda_sym((size_t)params::small_batch * N);
+    int failed = 0;
+    count = allocation_count;
+    start = chrono::steady_clock::now();
+    if (symmetric) {
+        small_eigenvalues_symmetric_batch(&batch[0], params::small_batch, &lambda_sym[0]);
+    } else {
+        failed = small_eigenvalues_batch(&batch[0], params::small_batch, &lambda[0]);
+    }
+    double batch_rate = params::small_batch / seconds_since(start);
+    long batch_alloc = allocation_count - count;
+    
+    // 固有値の和と対角和の差で精度を確かめる
+    for (int k = 0; k < params::small_batch; ++k) {
+        complex<double> sum = 0.0;
+        for (int i = 0; i < N; ++i) sum += symmetric ? lambda_sym[(size_t)k * N + i] : lambda[(size_t)k * N + i];
+        diff = max(diff, abs(sum - trace(batch[k])));
+    }
+    
+    cout << "  " << N << "x" << N << (symmetric ? " 対称  " : " 非対称") << "  一般の経路 = " << fixed << setprecision(3)
+         << general_rate / 1e6 << " M個/s  compute_eigenvalues = " << library_rate / 1e6 << " M個/s (確保 " << setprecision(1) << library_alloc << "回/個)"
+         << "  EigenMethod 版 = " << setprecision(3) << typed_rate / 1e6 << " M個/s (確保 " << setprecision(1) << typed_alloc << "回/個)"
+         << "  small_eigenvalues_batch = " << setprecision(3) << batch_rate / 1e6 << " M個/s (確保 " << batch_alloc << "回)"
+         << "  対角和との差 = " << scientific << setprecision(2) << diff;
+    if (failed) cout << "  未収束 " << failed << "個";
+    cout << endl;
+}
+
+// 行列ごとに並べた配列 (AoS) と, 要素ごとに並べて行列をまたいで SIMD で解く束 (SoA) の比較
+template <int N>
+void bench_small_soa(bool symmetric) {
+    vector<SmallMatrix<N> > batch(params::small_batch);
+    SmallMatrixBatch<N> soa(params::small_batch);
+    for (int k = 0; k < params::small_batch; ++k) {
+        for (int i = 1; i <= N; ++i) {
+            for (int j = 1; j <= N; ++j) batch[k](i, j) = rand() / (RAND_MAX + 1.0) - 0.5;
+        }
+        if (symmetric) {
+            for (int i = 1; i <= N; ++i) {
+                for (int j = 1; j < i; ++j) batch[k](i, j) = batch[k](j, i);
+            }
+        }
+        soa.set(k, batch[k]);
+    }
+    cout << "  " << N << "x" << N << (symmetric ? " 対称" : " 非対称") << endl;
+    
+    // compute_eigenvalues で1つずつ解く
+    Matrix A(N);
+    vector<complex<double> > vals;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int k = 0; k < params::small_library; ++k) {
+        for (int i = 1; i <= N; ++i) {
+            for (int j = 1; j <= N; ++j) A(i, j) = batch[k](i, j);
+        }
+        vals = compute_eigenvalues(A, symmetric ? "symmetric" : "qr");
+    }
+    cout << "    compute_eigenvalues      " << fixed << setprecision(3) << params::small_library / seconds_since(start) / 1e6 << " M個/s" << endl;
+    
+    vector<complex<double> > lambda((size_t)params::small_batch * N);
+    vector<double> lambda_sym((size_t)params::small_batch * N);
+    start = chrono::steady_clock::now();
+    if (symmetric) {
+        small_eigenvalues_symmetric_batch(&batch[0], params::small_batch, &lambda_sym[0]);
+    } else {
+        small_eigenvalues_batch(&batch[0], params::small_batch, &lambda[0]);
+    }
+    cout << "    AoS (1行列ずつ)          " << params::small_batch / seconds_since(start) / 1e6 << " M個/s" << endl;
+    
+    vector<double> re((size_t)params::small_batch * N), im((size_t)params::small_batch * N);
+    const GemmKernel kernels[] = {GEMM_SCALAR, GEMM_AVX2, GEMM_AVX512};
+    for (int s = 0; s < 3; ++s) {
+        cout << "    SoA " << left << setw(21) << gemm_kernel_name(kernels[s]) << right;
+        if (!gemm_kernel_available(kernels[s])) {
+            cout << "(この CPU では使えない)" << endl;
+            continue;
+        }
+        start = chrono::steady_clock::now();
+        int failed = symmetric ? small_eigenvalues_symmetric_batch(soa, &re[0], nullptr, 30, kernels[s])
+                               : small_eigenvalues_batch(soa, &re[0], &im[0], nullptr, 30 * N, kernels[s]);
+        double rate = params::small_batch / seconds_since(start);
+        
+        // 固有値の和と対角和の差で精度を確かめる
+        double diff = 0.0;
+        for (int k = 0; k < params::small_batch; ++k) {
+            double sum = 0.0;
+            for (int i = 0; i < N; ++i) sum += re[(size_t)i * params::small_batch + k];
+            diff = max(diff, abs(sum - trace(batch[k])));
+        }
+        cout << fixed << setprecision(3) << rate / 1e6 << " M個/s  対角和との差 = " << scientific << setprecision(2) << diff;
+        if (failed) cout << "  未収束 " << failed << "個";
+        cout << endl;
+    }
+}
+
+int main() {
+    srand(params::seed);
+    
+    cout << "べき乗法 (反復ごとに確保する版と作業領域を使い回す版)" << endl;
+    for (size_t i = 0; i < sizeof(params::power_sizes) / sizeof(params::power_sizes[0]); ++i) {
+        cout << "n = " << params::power_sizes[i] << endl;
+        bench_power(params::power_sizes[i]);
+    }
+    
+    cout << "行列積 (最速のカーネル: " << gemm_kernel_name(gemm_best_kernel()) << ")" << endl;
+    for (size_t i = 0; i < sizeof(params::gemm_sizes) / sizeof(params::gemm_sizes[0]); ++i) {
+        cout << "n = " << params::gemm_sizes[i] << endl;
+        bench_gemm(params::gemm_sizes[i]);
+    }
+    
+    cout << "行列演算の強スケーリング (ハードウェアスレッド数 = " << thread::hardware_concurrency() << ")" << endl;
+    cout << "n = " << params::scaling_size << endl;
+    bench_scaling(params::scaling_size);
+    
+    cout << "小さな固有値問題 (" << params::small_batch << " 個をまとめて解く)" << endl;
+    bench_small<3>(false);
+    bench_small<3>(true);
+    bench_small<4>(false);
+    bench_small<4>(true);
+    
+    cout << "小さな固有値問題の束 (行列ごとの配列と, 要素ごとに並べた束を SIMD で解く場合)" << endl;
+    bench_small_soa<3>(false);
+    bench_small_soa<3>(true);
+    bench_small_soa<4>(false);
+    bench_small_soa<4>(true);
+    bench_small_soa<5>(false);
+    bench_small_soa<6>(false);
+    
+    cout << "同じ大きさの問題の解き直し (逆反復法とダブルQR法, 関数と EigenSolver の比較)" << endl;
+    for (size_t i = 0; i < sizeof(params::solver_sizes) / sizeof(params::solver_sizes[0]); ++i) {
+        cout << "n = " << params::solver_sizes[i] << endl;
+        bench_solver(params::solver_sizes[i]);
+    }
+    
+    cout << "ヘッセンベルグ化の比較" << endl;
+    for (size_t i = 0; i < sizeof(params::sizes) / sizeof(params::sizes[0]); ++i) {
+        cout << "n = " << params::sizes[i] << endl;
+        bench_hessenberg(params::sizes[i]);
+    }
+    
+    cout << "対称行列の固有値 (一般のQR法と三重対角化+対称QR法)" << endl;
+    for (size_t i = 0; i < sizeof(params::sizes) / sizeof(params::sizes[0]); ++i) {
+        cout << "n = " << params::sizes[i] << endl;
+        bench_symmetric(params::sizes[i]);
+    }
+    
+    cout << "QR法の反復戦略の比較 (固有値1つあたりの反復回数と実行時間)" << endl;
+    for (size_t i = 0; i < sizeof(params::sizes) / sizeof(params::sizes[0]); ++i) {
+        cout << "n = " << params::sizes[i] << endl;
+        bench_qr_strategies(params::sizes[i]);
+    }
+    
+    cout << "固有対の精密化 (初期シフト = 固有値 + " << params::refine_offset << " x 固有値の間隔, " << params::refine_count << " 組)" << endl;
+    cout << "n = " << params::refine_size << endl;
+    bench_refine(params::refine_size);
+    
+    cout << "複数シフトの逆反復法" << endl;
+    cout << "n = " << params::batch_size << endl;
+    bench_batch(params::batch_size, true);
+    bench_batch(params::batch_size, false);
+    
+    cout << "密行列と疎行列の作用素によるべき乗法" << endl;
+    cout << "n = " << params::operator_size << endl;
+    bench_operator(params::operator_size);
+    
+    cout << "疎行列 (CSR) の積と固有値" << endl;
+    cout << "n = " << params::sparse_grid * params::sparse_grid << endl;
+    bench_sparse(params::sparse_grid);
+    
+    cout << "Krylov 部分空間法 (行列ベクトル積のみで絶対値の大きい " << params::krylov_k << " 個の固有値)" << endl;
+    for (size_t i = 0; i < sizeof(params::krylov_sizes) / sizeof(params::krylov_sizes[0]); ++i) {
+        cout << "n = " << params::krylov_sizes[i] << endl;
+        bench_krylov(params::krylov_sizes[i], true);
+        bench_krylov(params::krylov_sizes[i], false);
+    }
+    
+    return 0;
+}
@@ -5,6 +5,12 @@ using namespace std;
 namespace params {
     const double eps = 1e-10;     // 収束判定値
     const int max_iter = 100;     // 最大反復回数を100回に減らす
+    const double rqi_refactor = 1e-8;  // レイリー商反復でシフトを更新する最小の変化 (||A|| に対する比)
+    const double cluster_gap = 1e-3;   // 逆反復法で同じクラスタとみなすシフトの間隔 (||A||_F に対する比)
+    const int band_panel = 64;         // 非零構造のある行列積で, 掛ける行の範囲を揃える列の区間の幅
+    const int reduce_rows = 64;        // 並列の和や行ごとの処理で1区間にまとめる行数
+    const int transpose_tile = 32;     // 転置で1度に写すタイルの一辺
+    const int small_size = 4;          // 固定サイズの小さな行列の解法 (small_matrix.h) を使う最大の次数
 }
 
 // 単位行列の生成
@@ -16,49 +22,191 @@ Matrix create_identity(int n) {
     return I;
 }
 
+// 並列化の設定 (共有スレッドプールのスレッド数と, 並列化する最小の演算量)
+void set_parallel_options(int num_threads, double min_work) {
+    set_shared_thread_count(num_threads);
+    set_shared_parallel_threshold(min_work);
+}
+
+// 行ごとの和を params::reduce_rows 行ずつの部分和にしてから順に足す
+// (部分和の区切りがスレッド数によらないので, 結果もスレッド数によらない)
+static double parallel_row_sum(int m, double work, const function<double(int)>& row_value) {
+    int chunks = (m + params::reduce_rows - 1) / params::reduce_rows;
+    if (chunks <= 1) {
+        // 1ブロックに収まる小さな行列はスレッドプールも部分和の配列も使わない
+        double sum = 0.0;
+        for (int i = 1; i <= m; ++i) sum += row_value(i);
+        return sum;
+    }
+    // 部分和の配列は呼び出すスレッドごとに使い回す
+    static thread_local vector<double> partial;
+    partial.assign(chunks, 0.0);
+    struct Args { int m; double* partial; const function<double(int)>* row_value; } args = {m, &partial[0], &row_value};
+    Args* a = &args;
+    shared_parallel_for(0, chunks, 1, work, [a](int lo, int hi) {
+        for (int c = lo; c < hi; ++c) {
+            double sum = 0.0;
+            for (int i = c * params::reduce_rows; i < min(a->m, (c + 1) * params::reduce_rows); ++i) sum += (*a->row_value)(i + 1);
+            a->partial[c] = sum;
+        }
+    });
+    double sum = 0.0;
+    for (int c = 0; c < chunks; ++c) sum += partial[c];
+    return sum;
+}
+
 // 行列のノルムを計算
 double matrix_norm(const Matrix& A) {
-    double sum = 0.0;
-    for (int i = 1; i <= A.row(); ++i) {
-        for (int j = 1; j <= A.col(); ++j) {
-            sum += A(i, j) * A(i, j);
-        }
-    }
+    double sum = parallel_row_sum(A.row(), (double)A.row() * A.col(), [&](int i) {
+        double s = 0.0;
+        for (int j = 1; j <= A.col(); ++j) s += A(i, j) * A(i, j);
+        return s;
+    });
+    return sqrt(sum);
+}
+
+// 残差 ||A x - λ x||
+double residual_norm(const Matrix& A, const Vector& x, double lambda) {
+    double sum = parallel_row_sum(A.row(), (double)A.row() * A.col(), [&](int i) {
+        double r = -lambda * x(i);
+        for (int j = 1; j <= A.col(); ++j) r += A(i, j) * x(j);
+        return r * r;
+    });
     return sqrt(sum);
 }
 
+// C = A B (行優先の連続領域). C の行を gemm_params::mc 行ずつ共有スレッドプールに分配する
+// (各スレッドは B のブロックを自分でパッキングする)
+static void parallel_gemm(int m, int n, int k, const double* A, const double* B, double* C) {
+    struct Args { int n, k; const double* A; const double* B; double* C; } args = {n, k, A, B, C};
+    Args* a = &args;
+    shared_parallel_for(0, m, gemm_params::mc, (double)m * n * k, [a](int lo, int hi) {
+        gemm(hi - lo, a->n, a->k, a->A + (size_t)lo * a->k, a->k, a->B, a->n, a->C + (size_t)lo * a->n, a->n);
+    });
+}
+
+// 行列積 (要素を0始まりの連続領域に写して gemm を呼ぶ)
+void matrix_multiply(const Matrix& A, const Matrix& B, Matrix& C) {
+    int m = A.row(), k = A.col(), n = B.col();
+    vector<double> a((size_t)m * k), b((size_t)k * n), c((size_t)m * n);
+    shared_parallel_for(0, m, params::reduce_rows, (double)m * k, [&](int lo, int hi) {
+        for (int i = lo; i < hi; ++i) {
+            for (int j = 0; j < k; ++j) a[(size_t)i * k + j] = A(i+1, j+1);
+        }
+    });
+    shared_parallel_for(0, k, params::reduce_rows, (double)k * n, [&](int lo, int hi) {
+        for (int i = lo; i < hi; ++i) {
+            for (int j = 0; j < n; ++j) b[(size_t)i * n + j] = B(i+1, j+1);
+        }
+    });
+    parallel_gemm(m, n, k, &a[0], &b[0], &c[0]);
+    if (C.row() != m || C.col() != n) C = Matrix(m, n);
+    shared_parallel_for(0, m, params::reduce_rows, (double)m * n, [&](int lo, int hi) {
+        for (int i = lo; i < hi; ++i) {
+            for (int j = 0; j < n; ++j) C(i+1, j+1) = c[(size_t)i * n + j];
+        }
+    });
+}
+
+// 行列ベクトル積 (行を分けて並列に計算する)
+void matrix_vector_multiply(const Matrix& A, const Vector& x, Vector& y) {
+    int m = A.row(), n = A.col();
+    if (y.size() != m) y.resize(m);
+    shared_parallel_for(1, m + 1, params::reduce_rows, (double)m * n, [&](int lo, int hi) {
+        for (int i = lo; i < hi; ++i) {
+            double sum = 0.0;
+            for (int j = 1; j <= n; ++j) sum += A(i, j) * x(j);
+            y(i) = sum;
+        }
+    });
+}
+
+// 転置 (At の行を分け, params::transpose_tile 四方のタイルごとに写す)
+void transpose(const Matrix& A, Matrix& At) {
+    int m = A.row(), n = A.col();
+    if (At.row() != n || At.col() != m) At = Matrix(n, m);
+    const int tile = params::transpose_tile;
+    shared_parallel_for(0, (n + tile - 1) / tile, 1, (double)m * n, [&](int lo, int hi) {
+        for (int jb = lo * tile + 1; jb <= min(n, hi * tile); jb += tile) {
+            for (int ib = 1; ib <= m; ib += tile) {
+                for (int j = jb; j < min(n + 1, jb + tile); ++j) {
+                    for (int i = ib; i < min(m + 1, ib + tile); ++i) At(j, i) = A(i, j);
+                }
+            }
+        }
+    });
+}
+
 // べき乗法による最大固有値計算
 void power_method(const Matrix& A, double& eigenval, Vector& eigenvec) {
-    int n = A.row();
-    Vector x(n), x_new(n);
+    PowerWorkspace work;
+    power_method(A, eigenval, eigenvec, work, params::max_iter, params::eps, true);
+}
+
+// 作業領域を使い回すべき乗法
+int power_method(const Matrix& A, double& eigenval, Vector& eigenvec, PowerWorkspace& work,
+                 int max_iterations, double tolerance, bool verbose) {
+    MatrixOperator op(A);
+    return power_method(make_matvec(op), A.row(), eigenval, eigenvec, work, max_iterations, tolerance, verbose);
+}
+
+// 行列ベクトル積だけを使うべき乗法
+// 1反復は A x を求めてそのノルムを取る1パスと, 正規化と差のノルムを求める1パスだけで,
+// 反復中にヒープ確保は行わない (作業領域が足りないときの最初の1回のみ)
+int power_method(const MatVec& matvec, int n, double& eigenval, Vector& eigenvec, PowerWorkspace& work,
+                 int max_iterations, double tolerance, bool verbose) {
+    work.x.resize(n);
+    work.y.resize(n);
+    double* x = &work.x[0];
+    double* y = &work.y[0];
     
     // 初期ベクトルの設定(全ての要素を1に)
-    for(int i = 1; i <= n; i++) x(i) = 1.0;
-    normalize(x);
+    for (int i = 0; i < n; i++) x[i] = 1.0 / sqrt((double)n);
     
-    cout << "反復計算開始" << endl;
-    for(int iter = 0; iter < params::max_iter; iter++) {
-        x_new = A * x;
-        double lambda = norm(x_new);
-        x_new = x_new / lambda;
+    if (verbose) cout << "反復計算開始" << endl;
+    double lambda = 0.0;
+    int iter;
+    for (iter = 0; iter < max_iterations; iter++) {
+        // y = A x と ||y||^2
+        matvec(x, y);
+        double norm2 = 0.0;
+        for (int i = 0; i < n; i++) norm2 += y[i] * y[i];
+        lambda = sqrt(norm2);
         
-        // 収束判定と途中経過の出力
-        if(iter % 10 == 0) {
+        // y を正規化しながら ||y - x||^2 を求める
+        double scale = 1.0 / lambda;
+        double diff2 = 0.0;
+        for (int i = 0; i < n; i++) {
+            y[i] *= scale;
+            double d = y[i] - x[i];
+            diff2 += d * d;
+        }
+        swap(x, y);
+        
+        if (verbose && iter % 10 == 0) {
             cout << iter << "回目: 固有値 = " << lambda << endl;
         }
         
-        if(norm(x_new - x) < params::eps) {
-            eigenval = lambda;
-            eigenvec = x_new;
-            cout << "収束しました(" << iter + 1 << "回の反復)" << endl;
-            return;
+        if (sqrt(diff2) < tolerance) {
+            if (verbose) cout << "収束しました(" << iter + 1 << "回の反復)" << endl;
+            break;
         }
-        x = x_new;
     }
-    cout << "警告: 最大反復回数に達しました" << endl;
-    // 最後の推定値を返す
-    eigenval = norm(A * x);
-    eigenvec = x;
+    
+    bool converged = iter < max_iterations;
+    if (!converged) {
+        if (verbose) cout << "警告: 最大反復回数に達しました" << endl;
+        // 最後の推定値を返す
+        matvec(x, y);
+        double norm2 = 0.0;
+        for (int i = 0; i < n; i++) norm2 += y[i] * y[i];
+        lambda = sqrt(norm2);
+    }
+    
+    eigenval = lambda;
+    if (eigenvec.size() != n) eigenvec.resize(n);
+    for (int i = 1; i <= n; i++) eigenvec(i) = x[i-1];
+    return converged ? iter + 1 : -1;
 }
 
 // 逆べき乗法による特定の固有値計算
@@ -121,49 +269,183 @@ void inverse_power_method(const Matrix& A, double shift, double& eigenval, Vecto
     cout << "警告: 最大反復回数に達しました" << endl;
 }
 
-// Wilkinsonシフトの計算
-double wilkinson_shift(const Matrix& H, int n) {
-    if (abs(H(n, n-1)) < 1e-14) return H(n, n);
+// シフトを選べる逆反復法
+int inverse_power_method(const Matrix& A, double shift, double& eigenval, Vector& eigenvec,
+                         InverseIterationMode mode, int max_iterations, double tolerance, bool verbose) {
+    MatrixOperator op(A);
+    return inverse_power_method(make_matvec(op), make_shift_solve(op), A.row(), shift, eigenval, eigenvec,
+                                mode, max_iterations, tolerance, verbose, matrix_norm(A));
+}
+
+// 作用素のノルムの見積もり (数回のべき乗法による ||A||_2 の下からの近似)
+static double estimate_norm(const MatVec& matvec, int n) {
+    vector<double> x(n, 1.0 / sqrt((double)n)), y(n);
+    double estimate = 0.0;
+    for (int step = 0; step < 10; step++) {
+        matvec(&x[0], &y[0]);
+        double norm2 = 0.0;
+        for (int i = 0; i < n; i++) norm2 += y[i] * y[i];
+        if (norm2 == 0.0) break;
+        estimate = max(estimate, sqrt(norm2));
+        for (int i = 0; i < n; i++) x[i] = y[i] / sqrt(norm2);
+    }
+    return estimate;
+}
+
+// 積と連立方程式の解法だけを使う逆反復法
+// INVERSE_RAYLEIGH ではシフトを毎回レイリー商に置き換えるが, 前回解いたときから ||A|| の
+// params::rqi_refactor 倍以上動いたときだけ新しいシフトにする (それ以外は solve が分解を使い回せる)
+int inverse_power_method(const MatVec& matvec, const ShiftSolve& solve, int n, double shift, double& eigenval,
+                         Vector& eigenvec, InverseIterationMode mode, int max_iterations, double tolerance,
+                         bool verbose, double anorm) {
+    InverseWorkspace work;
+    return inverse_power_method(matvec, solve, n, shift, eigenval, eigenvec, work, mode, max_iterations, tolerance,
+                                verbose, anorm);
+}
+
+int inverse_power_method(const MatVec& matvec, const ShiftSolve& solve, int n, double shift, double& eigenval,
+                         Vector& eigenvec, InverseWorkspace& work, InverseIterationMode mode, int max_iterations,
+                         double tolerance, bool verbose, double anorm) {
+    if (anorm <= 0.0) anorm = estimate_norm(matvec, n);
+    vector<double>& x = work.x;
+    vector<double>& y = work.y;
+    vector<double>& Ax = work.Ax;
+    x.resize(n);
+    y.resize(n);
+    Ax.resize(n);
     
-    double a = H(n-1, n-1);
-    double b = H(n-1, n);
-    double c = H(n, n-1);
-    double d = H(n, n);
+    // 初期ベクトル (eigenvec に近似固有ベクトルが入っていればそれを使う)
+    double x_norm = 0.0;
+    if (eigenvec.size() == n) {
+        for (int i = 0; i < n; i++) {
+            x[i] = eigenvec(i+1);
+            x_norm += x[i] * x[i];
+        }
+    }
+    bool has_initial = x_norm > 0.0;
+    if (!has_initial) {
+        fill(x.begin(), x.end(), 1.0);
+        x_norm = n;
+    }
+    x_norm = sqrt(x_norm);
+    for (int i = 0; i < n; i++) x[i] /= x_norm;
+    
+    double solved_shift = 0.0;
+    bool solved = false;
+    bool rayleigh_shift = false;
+    bool rayleigh_failed = false;   // レイリー商のシフトで解けず, 固定シフトに戻した
+    bool failed = false;
+    double good_shift = 0.0;        // 最後に解けたシフト
+    bool has_good_shift = false;
+    double rayleigh = shift;
+    double residual = 0.0, prev_residual = numeric_limits<double>::max(), prev_ratio = 0.0;
+    
+    if (verbose) cout << "反復計算開始" << endl;
+    int iter;
+    for (iter = 0; iter < max_iterations; iter++) {
+        // レイリー商と残差 ||A x - ρ x||
+        matvec(&x[0], &Ax[0]);
+        rayleigh = 0.0;
+        for (int i = 0; i < n; i++) rayleigh += x[i] * Ax[i];
+        residual = 0.0;
+        for (int i = 0; i < n; i++) {
+            double r = Ax[i] - rayleigh * x[i];
+            residual += r * r;
+        }
+        residual = sqrt(residual);
+        
+        if (verbose) {
+            cout << iter << "回目: 固有値 ≈ " << rayleigh << "  残差 = " << residual << endl;
+        }
+        if (residual <= tolerance * anorm) break;
+        
+        // シフトを決める. 初期ベクトルが与えられていればすぐにレイリー商を使う.
+        // そうでなければ, まず初期シフトで反復する. このとき残差の縮小率 q は |λ - σ| / |λ2 - σ|
+        // (λ2 は2番目に近い固有値) に近づくので, q が安定し, 残差が隣の固有値との間隔の推定値
+        // |ρ - σ| (1/q - 1) の1割を下回ったら切り替える. 早く切り替えると, x にまだ多く残っている
+        // 隣の固有ベクトルに収束してしまう
+        double ratio = residual / prev_residual;
+        if (mode == INVERSE_RAYLEIGH && !rayleigh_shift && !rayleigh_failed &&
+            (has_initial || (iter >= 2 && ratio < 1.0 && abs(ratio - prev_ratio) <= 0.2 * ratio &&
+                             residual <= 0.1 * abs(rayleigh - shift) * (1.0 / ratio - 1.0)))) {
+            rayleigh_shift = true;
+        }
+        prev_residual = residual;
+        prev_ratio = ratio;
+        double sigma = rayleigh_shift ? rayleigh : shift;
+        if (solved && abs(sigma - solved_shift) <= params::rqi_refactor * anorm) sigma = solved_shift;
+        
+        // (A - σI) y = x を解いて正規化する.
+        // シフトがちょうど固有値に一致して解けなかったらわずかにずらす
+        double y_norm = 0.0;
+        auto try_solve = [&](double trial) {
+            if (verbose && (!solved || trial != solved_shift)) cout << "  シフト " << trial << " で解く" << endl;
+            solved = solve(trial, &x[0], &y[0]);
+            solved_shift = trial;
+            if (solved) {
+                y_norm = 0.0;
+                for (int i = 0; i < n; i++) y_norm += y[i] * y[i];
+                y_norm = sqrt(y_norm);
+                solved = y_norm > 0.0 && y_norm <= numeric_limits<double>::max();
+            }
+            return solved;
+        };
+        for (int attempt = 0; attempt < 3 && !try_solve(sigma); attempt++) {
+            sigma += 1e3 * numeric_limits<double>::epsilon() * max(anorm, abs(sigma));
+        }
+        if (!solved && rayleigh_shift && has_good_shift) {
+            // 反復解法 (GMRES など) はほぼ特異なレイリー商のシフトで停滞することがある.
+            // そのときは最後に解けたシフトに戻し, 以後は固定シフトで反復する
+            if (verbose) cout << "  レイリー商のシフトで解けないので, シフト " << good_shift << " に戻す" << endl;
+            rayleigh_shift = false;
+            rayleigh_failed = true;
+            shift = good_shift;
+            try_solve(shift);
+        }
+        if (!solved) {
+            failed = true;
+            break;
+        }
+        good_shift = solved_shift;
+        has_good_shift = true;
+        for (int i = 0; i < n; i++) x[i] = y[i] / y_norm;
+    }
     
-    double tr = a + d;
-    double det = a * d - b * c;
-    double disc = tr * tr - 4.0 * det;
+    if (failed) {
+        // 解けなかった連立方程式を収束と取り違えない
+        cout << "警告: シフト " << solved_shift << " の連立方程式が解けませんでした" << endl;
+        iter = -1;
+    } else if (iter == max_iterations) {
+        cout << "警告: 最大反復回数に達しました" << endl;
+        matvec(&x[0], &Ax[0]);
+        rayleigh = 0.0;
+        for (int i = 0; i < n; i++) rayleigh += x[i] * Ax[i];
+    } else if (verbose) {
+        cout << "収束しました(" << iter << "回の反復)" << endl;
+    }
     
-    if (disc < 0) return tr / 2.0;
+    eigenval = rayleigh;
+    if (eigenvec.size() != n) eigenvec.resize(n);
+    for (int i = 1; i <= n; i++) eigenvec(i) = x[i-1];
+    return iter;
+}
+
+// Wilkinsonシフトの計算
+double wilkinson_shift(const Matrix& H, int n) {
+    if (abs(H(n, n-1)) < 1e-14) return H(n, n);
     
-    double sqrt_disc = sqrt(disc);
-    double lambda1 = (tr + sqrt_disc) / 2.0;
-    double lambda2 = (tr - sqrt_disc) / 2.0;
+    complex<double> lambda1, lambda2;
+    small_eigenvalues_2x2(H(n-1, n-1), H(n-1, n), H(n, n-1), H(n, n), lambda1, lambda2);
+    if (lambda1.imag() != 0.0) return lambda1.real();
     
-    return abs(lambda1 - H(n,n)) < abs(lambda2 - H(n,n)) ? lambda1 : lambda2;
+    return abs(lambda1.real() - H(n,n)) < abs(lambda2.real() - H(n,n)) ? lambda1.real() : lambda2.real();
 }
 
 // 2x2ブロックの固有値計算
 pair<complex<double>, complex<double>> eigenvalues_2x2(const Matrix& H, int i) {
-    double a = H(i, i);
-    double b = H(i, i+1);
-    double c = H(i+1, i);
-    double d = H(i+1, i+1);
-    
-    double tr = a + d;
-    double det = a * d - b * c;
-    double disc = tr * tr - 4.0 * det;
-    
-    if (disc >= 0) {
-        double sqrt_disc = sqrt(disc);
-        double lambda1 = (tr + sqrt_disc) / 2.0;
-        double lambda2 = (tr - sqrt_disc) / 2.0;
-        return make_pair(complex<double>(lambda1, 0), complex<double>(lambda2, 0));
-    } else {
-        double real = tr / 2.0;
-        double imag = sqrt(-disc) / 2.0;
-        return make_pair(complex<double>(real, imag), complex<double>(real, -imag));
-    }
+    complex<double> lambda1, lambda2;
+    small_eigenvalues_2x2(H(i, i), H(i, i+1), H(i+1, i), H(i+1, i+1), lambda1, lambda2);
+    return make_pair(lambda1, lambda2);
 }
 
 // QR分解
@@ -207,98 +489,2293 @@ void qr_decomposition(Matrix& A, Matrix& Q, Matrix& R) {
     Q = trans(Q);
 }
 
-// ダブルQR法による固有値計算
-vector<complex<double>> eigenvalues_double_qr(Matrix A, int max_iterations, double tolerance) {
-    int n = A.row();
-    vector<complex<double>> eigenvalues;
-    Matrix H = A;
+// ハウスホルダー鏡映 P = I - tau v v^T (v(1) = 1) の生成
+// (alpha, x[0..m-2]) を (beta, 0, ..., 0) に写す. x は v(2..m) で上書きされ, tau を返す
+// x のノルムが negligible 以下なら x を0にして鏡映を省く (tau = 0)
+static double make_reflector(double& alpha, double* x, int m, double negligible = 0.0) {
+    double xnorm = 0.0;
+    for (int i = 0; i < m - 1; ++i) xnorm = hypot(xnorm, x[i]);
+    if (xnorm <= negligible) {
+        for (int i = 0; i < m - 1; ++i) x[i] = 0.0;
+        return 0.0;
+    }
+    
+    double beta = -copysign(hypot(alpha, xnorm), alpha);
+    double tau = (beta - alpha) / beta;
+    // |alpha - beta| >= |x[i]| なので, 逆数を掛けずに割れば非正規化数でもあふれない
+    double denom = alpha - beta;
+    for (int i = 0; i < m - 1; ++i) x[i] /= denom;
+    alpha = beta;
+    return tau;
+}
+
+// QR反復の設定
+struct QRWork {
+    double tolerance;        // 副対角要素を無視する閾値 (絶対値)
+    int max_iterations;      // 固有値1つあたりの反復上限
+    QRStrategy strategy;
+    bool wantt;              // true なら行列全体を更新して実Schur形を作る (false なら窓の内側のみ)
+    Matrix* Z;               // 直交変換を右から累積する行列 (不要なら nullptr)
+};
+
+// Francisのダブルシフトステップ (3x3 ハウスホルダー鏡映によるバルジ追跡)
+// 非簡約な窓 H(lo..hi, lo..hi) に対し, シフトの組 (複素共役でもよい) で
+// 実数演算のみでQR反復2回分をその場で適用する. 計算量は1反復あたり O((hi-lo)^2)
+// shift_sum, shift_prod はシフトの和と積 (通常は末尾2x2ブロックのトレースと行列式)
+static void francis_double_step(Matrix& H, int lo, int hi, double shift_sum, double shift_prod,
+                                const QRWork& w) {
+    // 変換を適用する行・列の範囲
+    int i1 = w.wantt ? 1 : lo;
+    int i2 = w.wantt ? H.row() : hi;
     
-    hess(H);
+    // (H - s1 I)(H - s2 I) の第1列 (非零なのは先頭3成分のみ)
+    double x = H(lo, lo) * H(lo, lo) + H(lo, lo+1) * H(lo+1, lo) - shift_sum * H(lo, lo) + shift_prod;
+    double y = H(lo+1, lo) * (H(lo, lo) + H(lo+1, lo+1) - shift_sum);
+    double z = H(lo+1, lo) * H(lo+2, lo+1);
     
-    double initial_norm = matrix_norm(H);
-    if (initial_norm < 1e-14) {
-        for (int i = 1; i <= n; ++i) {
-            eigenvalues.push_back(complex<double>(0.0, 0.0));
+    for (int k = lo; k <= hi - 1; ++k) {
+        // 最後の2行は2x2の鏡映で閉じる
+        int nr = min(3, hi - k + 1);
+        double v[2] = {y, z};
+        double tau = make_reflector(x, v, nr);
+        if (nr == 2) v[1] = 0.0;
+        
+        // 前の列に生じたバルジを消去
+        if (k > lo) {
+            H(k, k-1) = x;
+            H(k+1, k-1) = 0.0;
+            if (nr == 3) H(k+2, k-1) = 0.0;
+        }
+        
+        if (tau != 0.0) {
+            // 左から鏡映を適用 (k..k+nr-1 行)
+            for (int j = k; j <= i2; ++j) {
+                double sum = H(k, j) + v[0] * H(k+1, j);
+                if (nr == 3) sum += v[1] * H(k+2, j);
+                sum *= tau;
+                H(k, j) -= sum;
+                H(k+1, j) -= sum * v[0];
+                if (nr == 3) H(k+2, j) -= sum * v[1];
+            }
+            
+            // 右から鏡映を適用 (k..k+nr-1 列). バルジは k+3 行まで広がる
+            int last = min(k + 3, hi);
+            for (int i = i1; i <= last; ++i) {
+                double sum = H(i, k) + v[0] * H(i, k+1);
+                if (nr == 3) sum += v[1] * H(i, k+2);
+                sum *= tau;
+                H(i, k) -= sum;
+                H(i, k+1) -= sum * v[0];
+                if (nr == 3) H(i, k+2) -= sum * v[1];
+            }
+            
+            if (w.Z) {
+                Matrix& Z = *w.Z;
+                for (int i = 1; i <= Z.row(); ++i) {
+                    double sum = Z(i, k) + v[0] * Z(i, k+1);
+                    if (nr == 3) sum += v[1] * Z(i, k+2);
+                    sum *= tau;
+                    Z(i, k) -= sum;
+                    Z(i, k+1) -= sum * v[0];
+                    if (nr == 3) Z(i, k+2) -= sum * v[1];
+                }
+            }
+        }
+        
+        if (k < hi - 1) {
+            x = H(k+1, k);
+            y = H(k+2, k);
+            z = (k < hi - 2) ? H(k+3, k) : 0.0;
         }
-        return eigenvalues;
     }
+}
+
+// 密行列積 C = A * B (A は m x k, B は k x n, いずれも0始まり行優先の連続領域)
+// 計算はパッキングと SIMD のマイクロカーネルによる gemm (gemm.h) で行う
+// plo, phi を与えると, B の j 列で非零になりうる行は plo[j]..phi[j] に限られるとして,
+// 列を params::band_panel 列ずつに分け, 各区間で非零になりうる行の範囲だけを掛ける
+static void block_multiply(const double* A, const double* B, double* C, int m, int k, int n,
+                           const int* plo = nullptr, const int* phi = nullptr) {
+    if (!plo) {
+        parallel_gemm(m, n, k, A, B, C);
+        return;
+    }
+    for (int j0 = 0; j0 < n; j0 += params::band_panel) {
+        int nr = min(params::band_panel, n - j0);
+        int p1 = k, p2 = -1;
+        for (int c = 0; c < nr; ++c) {
+            p1 = min(p1, plo[j0 + c]);
+            p2 = max(p2, phi[j0 + c]);
+        }
+        gemm(m, nr, max(p2 - p1 + 1, 0), A + p1, k, B + (size_t)p1 * n + j0, n, C + j0, n);
+    }
+}
+
+// X(r1..r2, c1..c1+nu-1) = X(r1..r2, c1..c1+nu-1) * U (U は nu x nu)
+static void update_columns(Matrix& X, int r1, int r2, int c1, const vector<double>& U, int nu,
+                           const vector<int>& ulo, const vector<int>& uhi,
+                           vector<double>& buf, vector<double>& out) {
+    int m = r2 - r1 + 1;
+    if (m <= 0) return;
+    buf.resize((size_t)m * nu);
+    out.resize((size_t)m * nu);
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < nu; ++j) buf[(size_t)i * nu + j] = X(r1+i, c1+j);
+    }
+    block_multiply(&buf[0], &U[0], &out[0], m, nu, nu, &ulo[0], &uhi[0]);
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < nu; ++j) X(r1+i, c1+j) = out[(size_t)i * nu + j];
+    }
+}
+
+// X(r1..r1+nu-1, c1..c2) = U^T * X(r1..r1+nu-1, c1..c2)
+// 転置した (X^T U)^T として計算し, U の非零構造を update_columns と同じように使う
+static void update_rows(Matrix& X, int r1, int c1, int c2, const vector<double>& U, int nu,
+                        const vector<int>& ulo, const vector<int>& uhi,
+                        vector<double>& buf, vector<double>& out) {
+    int m = c2 - c1 + 1;
+    if (m <= 0) return;
+    buf.resize((size_t)m * nu);
+    out.resize((size_t)m * nu);
+    for (int i = 0; i < nu; ++i) {
+        for (int j = 0; j < m; ++j) buf[(size_t)j * nu + i] = X(r1+i, c1+j);
+    }
+    block_multiply(&buf[0], &U[0], &out[0], m, nu, nu, &ulo[0], &uhi[0]);
+    for (int i = 0; i < nu; ++i) {
+        for (int j = 0; j < m; ++j) X(r1+i, c1+j) = out[(size_t)j * nu + i];
+    }
+}
+
+// 小さなバルジを密に並べたマルチシフトQRスイープ
+// shifts の各組 (和, 積) ごとに 3x3 のバルジを窓 [lo, hi] の上端から導入し, 3行間隔の鎖として
+// まとめて追跡する. 追跡は対角近傍の小さな区間 J ごとに行い, その間の鏡映を直交行列 U に累積して,
+// J の外側 (上の行と右の列, 累積行列) へは区間の終わりにまとめて行列積で適用する
+static void multishift_sweep(Matrix& H, int lo, int hi, const vector<pair<double, double>>& shifts,
+                             const QRWork& w) {
+    int nbmps = (int)shifts.size();
+    if (nbmps == 0) return;
     
-    tolerance *= initial_norm;
-    
-    int current_size = n;
-    int iteration_count = 0;
+    int i1 = w.wantt ? 1 : lo;
+    int i2 = w.wantt ? H.row() : hi;
+    int nh = max(3 * nbmps, 12);    // 1区間で進めるステップ数
+    vector<double> U, buf, out;
+    vector<int> urow_lo, urow_hi;   // U の各列で非零になりうる行の範囲
     
-    while (current_size > 1 && iteration_count < max_iterations) {
-        if (current_size == 2) {
-            pair<complex<double>, complex<double>> vals = eigenvalues_2x2(H, 1);
-            eigenvalues.push_back(vals.first);
-            eigenvalues.push_back(vals.second);
-            break;
+    for (int incol = lo - 1 - 3 * (nbmps - 1); incol <= hi - 2; incol += nh) {
+        int jfirst = max(lo, incol + 1);
+        int jlast = min(hi, incol + nh + 3 * nbmps);
+        int nu = jlast - jfirst + 1;
+        U.assign((size_t)nu * nu, 0.0);
+        urow_lo.resize(nu);
+        urow_hi.resize(nu);
+        for (int i = 0; i < nu; ++i) {
+            U[(size_t)i * nu + i] = 1.0;
+            urow_lo[i] = urow_hi[i] = i;
         }
         
-        if (abs(H(current_size, current_size-1)) < tolerance) {
-            eigenvalues.push_back(complex<double>(H(current_size, current_size), 0));
-            current_size--;
-            continue;
+        for (int krcol = incol; krcol <= min(incol + nh - 1, hi - 2); ++krcol) {
+            // 下のバルジから順に1行ずつ進める
+            for (int m = nbmps - 1; m >= 0; --m) {
+                int k = krcol + 3 * m;
+                if (k < lo - 1 || k > hi - 2) continue;
+                
+                int nr = min(3, hi - k);
+                double alpha, v[2];
+                if (k == lo - 1) {
+                    // (H - s1 I)(H - s2 I) の第1列から新しいバルジを導入する
+                    double sum = shifts[m].first, prod = shifts[m].second;
+                    alpha = H(lo, lo) * H(lo, lo) + H(lo, lo+1) * H(lo+1, lo) - sum * H(lo, lo) + prod;
+                    v[0] = H(lo+1, lo) * (H(lo, lo) + H(lo+1, lo+1) - sum);
+                    v[1] = H(lo+1, lo) * H(lo+2, lo+1);
+                } else {
+                    alpha = H(k+1, k);
+                    v[0] = H(k+2, k);
+                    v[1] = (nr == 3) ? H(k+3, k) : 0.0;
+                }
+                double tau = make_reflector(alpha, v, nr);
+                if (nr == 2) v[1] = 0.0;
+                
+                if (k >= lo) {
+                    H(k+1, k) = alpha;
+                    H(k+2, k) = 0.0;
+                    if (nr == 3) H(k+3, k) = 0.0;
+                }
+                if (tau == 0.0) continue;
+                
+                // 区間 J の内側だけに左右から適用する
+                for (int j = k + 1; j <= jlast; ++j) {
+                    double s = H(k+1, j) + v[0] * H(k+2, j);
+                    if (nr == 3) s += v[1] * H(k+3, j);
+                    s *= tau;
+                    H(k+1, j) -= s;
+                    H(k+2, j) -= s * v[0];
+                    if (nr == 3) H(k+3, j) -= s * v[1];
+                }
+                int last = min(k + 4, hi);
+                for (int i = jfirst; i <= last; ++i) {
+                    double s = H(i, k+1) + v[0] * H(i, k+2);
+                    if (nr == 3) s += v[1] * H(i, k+3);
+                    s *= tau;
+                    H(i, k+1) -= s;
+                    H(i, k+2) -= s * v[0];
+                    if (nr == 3) H(i, k+3) -= s * v[1];
+                }
+                
+                int c = k + 1 - jfirst;
+                int rlo = min(urow_lo[c], urow_lo[c+1]);
+                int rhi = max(urow_hi[c], urow_hi[c+1]);
+                if (nr == 3) {
+                    rlo = min(rlo, urow_lo[c+2]);
+                    rhi = max(rhi, urow_hi[c+2]);
+                }
+                for (int j = c; j < c + nr; ++j) {
+                    urow_lo[j] = rlo;
+                    urow_hi[j] = rhi;
+                }
+                for (int i = rlo; i <= rhi; ++i) {
+                    double* u = &U[(size_t)i * nu + c];
+                    double s = u[0] + v[0] * u[1];
+                    if (nr == 3) s += v[1] * u[2];
+                    s *= tau;
+                    u[0] -= s;
+                    u[1] -= s * v[0];
+                    if (nr == 3) u[2] -= s * v[1];
+                }
+            }
         }
         
-        double shift = wilkinson_shift(H, current_size);
+        // 区間 J の外側への遅延更新 (行列積)
+        update_columns(H, i1, jfirst - 1, jfirst, U, nu, urow_lo, urow_hi, buf, out);
+        update_rows(H, jfirst, jlast + 1, i2, U, nu, urow_lo, urow_hi, buf, out);
+        if (w.Z) update_columns(*w.Z, 1, w.Z->row(), jfirst, U, nu, urow_lo, urow_hi, buf, out);
+    }
+}
+
+// ハウスホルダー変換による上ヘッセンベルグ化 (非ブロック版)
+// A(ilo..ihi, ilo..ihi) を簡約する. 左からの変換は ilo..A.col() 列, 右からの変換は 1..ihi 行に適用し,
+// Q が与えられれば右から累積する. 鏡映は行列を陽に作らず, 行方向に連続なランク1更新で適用する
+static void reduce_to_hessenberg(Matrix& A, int ilo, int ihi, Matrix* Q, double negligible,
+                                 vector<double>& v, vector<double>& w) {
+    int ncol = A.col();
+    v.resize(max(ihi - ilo, 1));
+    w.resize(ncol + 1);
+    
+    for (int k = ilo; k <= ihi - 2; ++k) {
+        int len = ihi - k;
+        double alpha = A(k+1, k);
+        for (int i = 1; i < len; ++i) v[i] = A(k+1+i, k);
+        double tau = make_reflector(alpha, &v[1], len, negligible);
+        v[0] = 1.0;
+        
+        A(k+1, k) = alpha;
+        for (int i = 1; i < len; ++i) A(k+1+i, k) = 0.0;
+        if (tau == 0.0) continue;
         
-        Matrix Q(current_size), R(current_size);
-        Matrix H_shifted = H;
-        for (int i = 1; i <= current_size; ++i) {
-            H_shifted(i, i) -= shift;
+        // 左から: A(k+1..ihi, k+1..ncol) -= tau v (v^T A)
+        for (int j = k + 1; j <= ncol; ++j) w[j] = 0.0;
+        for (int i = 0; i < len; ++i) {
+            double vi = v[i];
+            for (int j = k + 1; j <= ncol; ++j) w[j] += vi * A(k+1+i, j);
+        }
+        for (int i = 0; i < len; ++i) {
+            double vi = tau * v[i];
+            for (int j = k + 1; j <= ncol; ++j) A(k+1+i, j) -= vi * w[j];
         }
         
-        qr_decomposition(H_shifted, Q, R);
+        // 右から: A(1..ihi, k+1..ihi) -= tau (A v) v^T
+        for (int i = 1; i <= ihi; ++i) {
+            double sum = 0.0;
+            for (int j = 0; j < len; ++j) sum += A(i, k+1+j) * v[j];
+            sum *= tau;
+            for (int j = 0; j < len; ++j) A(i, k+1+j) -= sum * v[j];
+        }
         
-        Matrix H_new = R * Q;
-        for (int i = 1; i <= current_size; ++i) {
-            H_new(i, i) += shift;
+        if (Q) {
+            for (int i = 1; i <= Q->row(); ++i) {
+                double sum = 0.0;
+                for (int j = 0; j < len; ++j) sum += (*Q)(i, k+1+j) * v[j];
+                sum *= tau;
+                for (int j = 0; j < len; ++j) (*Q)(i, k+1+j) -= sum * v[j];
+            }
         }
+    }
+}
+
+static void reduce_to_hessenberg(Matrix& A, int ilo, int ihi, Matrix* Q, double negligible = 0.0) {
+    vector<double> v, w;
+    reduce_to_hessenberg(A, ilo, ihi, Q, negligible, v, w);
+}
+
+// ブロック化したハウスホルダー変換による上ヘッセンベルグ化
+// nb 列ずつパネルを簡約し, パネル内の鏡映を compact WY 形 I - V T V^T にまとめる.
+// パネル内の列には Y = A V T を使って右からの変換を遅延適用し,
+// 残りの列への更新はパネルの終わりに行列積でまとめて行う
+static void reduce_to_hessenberg_blocked(Matrix& A, int nb, Matrix* Q, double negligible, HessenbergWork& work) {
+    int n = A.row();
+    const int crossover = 2 * nb;   // 残りがこれより小さければ非ブロック版で仕上げる
+    vector<double>& V = work.V, & Y = work.Y, & T = work.T, & v = work.v, & Vt = work.Vt, & Vtr = work.Vtr;
+    vector<double>& W = work.W, & TW = work.TW, & QV = work.QV, & QVT = work.QVT, & buf = work.buf, & out = work.out;
+    vector<double>& wv = work.wv;
+    
+    int i = 1;
+    for (; i <= n - 2 && n - i >= crossover; i += nb) {
+        int ib = min(nb, n - 1 - i);
+        int len = n - i;            // 鏡映が作用する行 i+1..n の数
+        
+        V.assign((size_t)len * ib, 0.0);    // V(r, j): 行 i+r の成分 (0始まり)
+        Y.assign((size_t)n * ib, 0.0);      // Y(r, j): 行 r+1
+        T.assign((size_t)ib * ib, 0.0);
+        v.resize(len);
+        wv.resize(ib);
         
-        for (int i = 1; i <= current_size; ++i) {
-            for (int j = 1; j <= current_size; ++j) {
-                H(i, j) = H_new(i, j);
-                if (abs(H(i, j)) < tolerance) H(i, j) = 0.0;
+        for (int j = 0; j < ib; ++j) {
+            int c = i + j;
+            
+            if (j > 0) {
+                // 右から: A(:, c) -= Y(:, 0..j-1) V(c, 0..j-1)^T
+                const double* vc = &V[(size_t)(c - i - 1) * ib];
+                for (int r = 0; r < n; ++r) {
+                    double sum = 0.0;
+                    for (int p = 0; p < j; ++p) sum += Y[(size_t)r * ib + p] * vc[p];
+                    A(r+1, c) -= sum;
+                }
+                // 左から: A(i+1.., c) -= V T^T V^T A(i+1.., c)
+                for (int p = 0; p < j; ++p) wv[p] = 0.0;
+                for (int r = 0; r < len; ++r) {
+                    double a = A(i+1+r, c);
+                    for (int p = 0; p < j; ++p) wv[p] += V[(size_t)r * ib + p] * a;
+                }
+                for (int p = j - 1; p >= 0; --p) {
+                    double sum = 0.0;
+                    for (int q = 0; q <= p; ++q) sum += T[(size_t)q * ib + p] * wv[q];
+                    wv[p] = sum;
+                }
+                for (int r = 0; r < len; ++r) {
+                    double sum = 0.0;
+                    for (int p = 0; p < j; ++p) sum += V[(size_t)r * ib + p] * wv[p];
+                    A(i+1+r, c) -= sum;
+                }
+            }
+            
+            // c 列の副対角より下を消す鏡映
+            int off = c - i;                // v は行 c+1 (= i+1+off) から
+            int vlen = n - c;
+            double alpha = A(c+1, c);
+            for (int r = 1; r < vlen; ++r) v[r] = A(c+1+r, c);
+            double tau = make_reflector(alpha, &v[1], vlen, negligible);
+            v[0] = 1.0;
+            A(c+1, c) = alpha;
+            for (int r = 1; r < vlen; ++r) A(c+1+r, c) = 0.0;
+            for (int r = 0; r < vlen; ++r) V[(size_t)(off + r) * ib + j] = v[r];
+            
+            // T の j 列: T(0..j-1, j) = -tau T (V^T v)
+            for (int p = 0; p < j; ++p) {
+                double sum = 0.0;
+                for (int r = 0; r < vlen; ++r) sum += V[(size_t)(off + r) * ib + p] * v[r];
+                wv[p] = sum;
+            }
+            for (int p = 0; p < j; ++p) {
+                double sum = 0.0;
+                for (int q = p; q < j; ++q) sum += T[(size_t)p * ib + q] * wv[q];
+                T[(size_t)p * ib + j] = -tau * sum;
+            }
+            T[(size_t)j * ib + j] = tau;
+            
+            // Y の j 列: tau (A(:, c+1..n) v - Y (V^T v))
+            for (int r = 0; r < n; ++r) {
+                double sum = 0.0;
+                for (int q = 0; q < vlen; ++q) sum += A(r+1, c+1+q) * v[q];
+                for (int p = 0; p < j; ++p) sum -= Y[(size_t)r * ib + p] * wv[p];
+                Y[(size_t)r * ib + j] = tau * sum;
             }
         }
         
-        iteration_count++;
+        // 残りの列 i+ib..n への右からの更新: A(:, cols) -= Y V(cols, :)^T
+        int c0 = i + ib;
+        int m = n - c0 + 1;
+        Vt.resize((size_t)ib * m);
+        for (int p = 0; p < ib; ++p) {
+            for (int q = 0; q < m; ++q) Vt[(size_t)p * m + q] = V[(size_t)(c0 - i - 1 + q) * ib + p];
+        }
+        out.resize((size_t)n * m);
+        block_multiply(&Y[0], &Vt[0], &out[0], n, ib, m);
+        for (int r = 0; r < n; ++r) {
+            for (int q = 0; q < m; ++q) A(r+1, c0+q) -= out[(size_t)r * m + q];
+        }
+        
+        // 左からの更新: A(i+1..n, cols) -= V T^T (V^T A(i+1..n, cols))
+        buf.resize((size_t)len * m);
+        for (int r = 0; r < len; ++r) {
+            for (int q = 0; q < m; ++q) buf[(size_t)r * m + q] = A(i+1+r, c0+q);
+        }
+        Vtr.resize((size_t)ib * len);
+        W.resize((size_t)ib * m);
+        TW.resize((size_t)ib * m);
+        for (int r = 0; r < len; ++r) {
+            for (int p = 0; p < ib; ++p) Vtr[(size_t)p * len + r] = V[(size_t)r * ib + p];
+        }
+        block_multiply(&Vtr[0], &buf[0], &W[0], ib, len, m);
+        for (int p = 0; p < ib; ++p) {
+            double* tw = &TW[(size_t)p * m];
+            for (int q = 0; q < m; ++q) tw[q] = 0.0;
+            for (int s = 0; s <= p; ++s) {
+                double t = T[(size_t)s * ib + p];
+                const double* w = &W[(size_t)s * m];
+                for (int q = 0; q < m; ++q) tw[q] += t * w[q];
+            }
+        }
+        out.resize((size_t)len * m);
+        block_multiply(&V[0], &TW[0], &out[0], len, ib, m);
+        for (int r = 0; r < len; ++r) {
+            for (int q = 0; q < m; ++q) A(i+1+r, c0+q) -= out[(size_t)r * m + q];
+        }
+        
+        // 累積: Q(:, i+1..n) -= (Q V T) V^T
+        if (Q) {
+            int nq = Q->row();
+            buf.resize((size_t)nq * len);
+            for (int r = 0; r < nq; ++r) {
+                for (int q = 0; q < len; ++q) buf[(size_t)r * len + q] = (*Q)(r+1, i+1+q);
+            }
+            QV.resize((size_t)nq * ib);
+            QVT.resize((size_t)nq * ib);
+            block_multiply(&buf[0], &V[0], &QV[0], nq, len, ib);
+            block_multiply(&QV[0], &T[0], &QVT[0], nq, ib, ib);
+            out.resize((size_t)nq * len);
+            block_multiply(&QVT[0], &Vtr[0], &out[0], nq, ib, len);
+            for (int r = 0; r < nq; ++r) {
+                for (int q = 0; q < len; ++q) (*Q)(r+1, i+1+q) -= out[(size_t)r * len + q];
+            }
+        }
+    }
+    
+    reduce_to_hessenberg(A, i, n, Q, negligible, work.v, work.w);
+}
+
+// ハウスホルダー変換による上ヘッセンベルグ化
+void hessenberg_reduction(Matrix& A, Matrix* Q, int block_size) {
+    HessenbergWork work;
+    hessenberg_reduction(A, work, Q, block_size);
+}
+
+void hessenberg_reduction(Matrix& A, HessenbergWork& work, Matrix* Q, int block_size) {
+    int n = A.row();
+    if (Q) *Q = create_identity(n);
+    
+    // 丸め誤差よりはるかに小さい列は消去済みとみなす. 階数落ちの行列で
+    // 誤差の積が非正規化数まで小さくなり, 演算が極端に遅くなるのを防ぐ
+    double eps = numeric_limits<double>::epsilon();
+    double negligible = eps * eps * matrix_norm(A);
+    
+    if (block_size > 1 && n >= 4 * block_size) {
+        reduce_to_hessenberg_blocked(A, block_size, Q, negligible, work);
+    } else {
+        reduce_to_hessenberg(A, 1, n, Q, negligible, work.v, work.w);
+    }
+}
+
+static pair<complex<double>, complex<double>> standardize_schur_block(Matrix& H, int k, const QRWork& w);
+
+// 実Schur形 T の隣接する対角ブロック (j 行目から始まる p x p と j+p 行目から始まる q x q) を
+// 直交相似変換で入れ替え, 変換を V に累積する. 入れ替えが不安定なら何もせず false を返す
+// 入れ替え後の 2x2 ブロックは標準化し直す (実固有値の対になったものは 1x1 ブロック2つに分かれる)
+static bool swap_schur_blocks(Matrix& T, Matrix& V, int j, int p, int q) {
+    int m = T.row();
+    int k = p + q;
+    
+    // Sylvester方程式 A11 X - X A22 = A12 をクロネッカー積の形で解く (未知数は p*q <= 4 個)
+    // X(a, b) は x[a + b*p] に対応する
+    int nx = p * q;
+    double M[4][5] = {};
+    for (int a = 0; a < p; ++a) {
+        for (int b = 0; b < q; ++b) {
+            int r = a + b * p;
+            for (int c = 0; c < p; ++c) M[r][c + b*p] += T(j+a, j+c);
+            for (int d = 0; d < q; ++d) M[r][a + d*p] -= T(j+p+d, j+p+b);
+            M[r][nx] = T(j+a, j+p+b);
+        }
     }
     
-    if (current_size == 1) {
-        eigenvalues.push_back(complex<double>(H(1, 1), 0));
+    double block_norm = 0.0;
+    for (int a = 0; a < k; ++a) {
+        for (int b = 0; b < k; ++b) block_norm = max(block_norm, abs(T(j+a, j+b)));
     }
+    double small = 1e-15 * max(block_norm, 1e-300);
     
-    return eigenvalues;
+    for (int c = 0; c < nx; ++c) {
+        int piv = c;
+        for (int r = c + 1; r < nx; ++r) {
+            if (abs(M[r][c]) > abs(M[piv][c])) piv = r;
+        }
+        if (abs(M[piv][c]) < small) return false;  // 2つのブロックが固有値を共有している
+        for (int b = 0; b <= nx; ++b) swap(M[c][b], M[piv][b]);
+        for (int r = c + 1; r < nx; ++r) {
+            double f = M[r][c] / M[c][c];
+            for (int b = c; b <= nx; ++b) M[r][b] -= f * M[c][b];
+        }
+    }
+    double x[4];
+    for (int c = nx - 1; c >= 0; --c) {
+        double sum = M[c][nx];
+        for (int b = c + 1; b < nx; ++b) sum -= M[c][b] * x[b];
+        x[c] = sum / M[c][c];
+    }
+    
+    // [-X; I] のQR分解の直交因子 G を作る. G の先頭 q 列は A22 の不変部分空間を張る
+    double W[4][2], G[4][4];
+    for (int a = 0; a < k; ++a) {
+        for (int b = 0; b < q; ++b) W[a][b] = (a < p) ? -x[a + b*p] : (a - p == b ? 1.0 : 0.0);
+        for (int b = 0; b < k; ++b) G[a][b] = (a == b) ? 1.0 : 0.0;
+    }
+    for (int c = 0; c < q; ++c) {
+        double u[4];
+        double alpha = W[c][c];
+        for (int a = c + 1; a < k; ++a) u[a] = W[a][c];
+        double tau = make_reflector(alpha, &u[c+1], k - c);
+        u[c] = 1.0;
+        if (tau == 0.0) continue;
+        for (int b = c; b < q; ++b) {
+            double sum = 0.0;
+            for (int a = c; a < k; ++a) sum += u[a] * W[a][b];
+            sum *= tau;
+            for (int a = c; a < k; ++a) W[a][b] -= sum * u[a];
+        }
+        for (int a = 0; a < k; ++a) {
+            double sum = 0.0;
+            for (int b = c; b < k; ++b) sum += G[a][b] * u[b];
+            sum *= tau;
+            for (int b = c; b < k; ++b) G[a][b] -= sum * u[b];
+        }
+    }
+    
+    // 入れ替え後の対角ブロックで左下が十分小さいことを確かめてから全体に適用する
+    double B[4][4], C[4][4];
+    for (int a = 0; a < k; ++a) {
+        for (int b = 0; b < k; ++b) {
+            double sum = 0.0;
+            for (int c = 0; c < k; ++c) sum += T(j+a, j+c) * G[c][b];
+            C[a][b] = sum;
+        }
+    }
+    for (int a = 0; a < k; ++a) {
+        for (int b = 0; b < k; ++b) {
+            double sum = 0.0;
+            for (int c = 0; c < k; ++c) sum += G[c][a] * C[c][b];
+            B[a][b] = sum;
+        }
+    }
+    for (int a = q; a < k; ++a) {
+        for (int b = 0; b < q; ++b) {
+            if (abs(B[a][b]) > 10.0 * 2.2e-16 * max(block_norm, 1e-300)) return false;
+        }
+    }
+    
+    double tmp[4];
+    for (int c = j; c <= m; ++c) {
+        for (int a = 0; a < k; ++a) {
+            double sum = 0.0;
+            for (int b = 0; b < k; ++b) sum += G[b][a] * T(j+b, c);
+            tmp[a] = sum;
+        }
+        for (int a = 0; a < k; ++a) T(j+a, c) = tmp[a];
+    }
+    for (int r = 1; r < j + k; ++r) {
+        for (int a = 0; a < k; ++a) {
+            double sum = 0.0;
+            for (int b = 0; b < k; ++b) sum += T(r, j+b) * G[b][a];
+            tmp[a] = sum;
+        }
+        for (int a = 0; a < k; ++a) T(r, j+a) = tmp[a];
+    }
+    for (int r = 1; r <= V.row(); ++r) {
+        for (int a = 0; a < k; ++a) {
+            double sum = 0.0;
+            for (int b = 0; b < k; ++b) sum += V(r, j+b) * G[b][a];
+            tmp[a] = sum;
+        }
+        for (int a = 0; a < k; ++a) V(r, j+a) = tmp[a];
+    }
+    
+    // 入れ替え後のブロック構造に合わせて下三角部分を厳密に0にする
+    for (int a = 0; a < k; ++a) {
+        for (int b = 0; b < a; ++b) {
+            bool inside_block = (a < q && b < q) || (a >= q && b >= q);
+            if (!inside_block || a - b > 1) T(j+a, j+b) = 0.0;
+        }
+    }
+    
+    QRWork w;
+    w.tolerance = 0.0;
+    w.max_iterations = 0;
+    w.strategy = QR_FRANCIS;
+    w.wantt = true;
+    w.Z = &V;
+    if (q == 2) standardize_schur_block(T, j, w);
+    if (p == 2) standardize_schur_block(T, j + q, w);
+    return true;
 }
 
-// 統合インターフェース
-vector<complex<double>> compute_eigenvalues(const Matrix& A, const string& method, double shift) {
-    vector<complex<double>> eigenvalues;
+// 実Schur形 T の ifst 行目から始まる対角ブロックを, 隣接ブロックとの入れ替えを繰り返して
+// ilst 行目まで上に移動する (ilst <= ifst で, ilst はブロックの先頭). LAPACK の dtrexc と同じく
+// ilst には実際にブロックが止まった行を返し, 途中で入れ替えに失敗すれば false を返す.
+// 移動中に 2x2 ブロックが実固有値の対に分かれたときは上の 1x1 ブロックだけを移動し続ける
+static bool move_schur_block(Matrix& T, Matrix& V, int ifst, int& ilst) {
+    int nb = (ifst < T.row() && T(ifst+1, ifst) != 0.0) ? 2 : 1;
+    int here = ifst;
     
-    if (method == "qr") {
-        // ダブルQR法(全ての固有値を計算)
-        return eigenvalues_double_qr(A);
-    }
-    else if (method == "power") {
-        // べき乗法(最大固有値のみ)
-        double eigenval;
-        Vector eigenvec;
-        power_method(A, eigenval, eigenvec);
-        eigenvalues.push_back(complex<double>(eigenval, 0.0));
-    }
-    else if (method == "inverse") {
-        // 逆べき乗法(シフト値に最も近い固有値)
-        double eigenval;
-        Vector eigenvec;
-        inverse_power_method(A, shift, eigenval, eigenvec);
-        eigenvalues.push_back(complex<double>(eigenval, 0.0));
-    }
-    else {
-        cout << "エラー: 未知の計算方法です" << endl;
+    while (here > ilst) {
+        int nbnext = (here - 2 >= ilst && T(here-1, here-2) != 0.0) ? 2 : 1;
+        if (!swap_schur_blocks(T, V, here - nbnext, nbnext, nb)) {
+            ilst = here;
+            return false;
+        }
+        here -= nbnext;
+        if (nb == 2 && T(here+1, here) == 0.0) nb = 1;
     }
+    return true;
+}
+
+// 実Schur形 T の先頭 ns 行の固有値を下から順にダブルシフトの組 (和, 積) として取り出す
+// 複素共役対はそのまま, 実固有値は2つずつ組にする. 多くとも max_shifts 個まで
+static void collect_shifts(const Matrix& T, int ns, int max_shifts, vector<pair<double, double>>& shifts) {
+    shifts.clear();
+    int count = 0;
+    bool has_pending = false;
+    double pending = 0.0;
     
-    return eigenvalues;
+    for (int i = ns; i >= 1 && count + 2 <= max_shifts; ) {
+        if (i > 1 && T(i, i-1) != 0.0) {
+            pair<complex<double>, complex<double>> vals = eigenvalues_2x2(T, i-1);
+            if (vals.first.imag() != 0.0) {
+                shifts.push_back(make_pair(2.0 * vals.first.real(), norm(vals.first)));
+                count += 2;
+                i -= 2;
+                continue;
+            }
+            double reals[2] = {vals.first.real(), vals.second.real()};
+            for (int r = 0; r < 2 && count + 2 <= max_shifts; ++r) {
+                if (has_pending) {
+                    shifts.push_back(make_pair(pending + reals[r], pending * reals[r]));
+                    count += 2;
+                    has_pending = false;
+                } else {
+                    pending = reals[r];
+                    has_pending = true;
+                }
+            }
+            i -= 2;
+        } else {
+            if (has_pending) {
+                shifts.push_back(make_pair(pending + T(i, i), pending * T(i, i)));
+                count += 2;
+                has_pending = false;
+            } else {
+                pending = T(i, i);
+                has_pending = true;
+            }
+            i -= 1;
+        }
+    }
+}
+
+static bool qr_iterate(Matrix& H, int lo_bound, int hi, const QRWork& w,
+                       vector<complex<double>>& eigenvalues, vector<int>* iteration_counts);
+
+// 積極的早期収縮 (AED)
+// 窓 [lo, hi] の末尾 nw x nw ブロックを実Schur分解し, 窓の上との結合 (スパイク) が
+// 無視できる固有値をまとめて収縮する. 収縮できた個数を返し,
+// 収縮できなかった固有値を次のスイープのシフトとして shifts に格納する
+static int aggressive_early_deflation(Matrix& H, int lo, int hi, int nw, int max_shifts, const QRWork& w,
+                                      vector<pair<double, double>>& shifts) {
+    int n = H.row();
+    int kwtop = hi - nw + 1;
+    double s = (kwtop > lo) ? H(kwtop, kwtop-1) : 0.0;
+    shifts.clear();
+    
+    Matrix T(nw), V(nw);
+    for (int i = 1; i <= nw; ++i) {
+        for (int j = max(i - 1, 1); j <= nw; ++j) T(i, j) = H(kwtop+i-1, kwtop+j-1);
+        V(i, i) = 1.0;
+    }
+    
+    QRWork small = w;
+    small.strategy = QR_FRANCIS;
+    small.wantt = true;
+    small.Z = &V;
+    vector<complex<double>> unused;
+    if (!qr_iterate(T, 1, nw, small, unused, nullptr)) return 0;
+    
+    // 下のブロックから順に収縮判定し, 収縮できないブロックは上へ移動する
+    // (1..ilst-1 行は収縮できないと決まったブロック. 移動に失敗したときは止まった位置までを
+    // 収縮できないものとして扱い, ilst は常にブロックの先頭に置く)
+    int ns = nw;
+    int ilst = 1;
+    while (ilst <= ns) {
+        bool bulge = ns > 1 && T(ns, ns-1) != 0.0;
+        if (!bulge) {
+            if (abs(s * V(1, ns)) < w.tolerance) {
+                ns--;
+                continue;
+            }
+            move_schur_block(T, V, ns, ilst);
+        } else {
+            if (max(abs(s * V(1, ns-1)), abs(s * V(1, ns))) < w.tolerance) {
+                ns -= 2;
+                continue;
+            }
+            move_schur_block(T, V, ns - 1, ilst);
+        }
+        ilst += (ilst < nw && T(ilst+1, ilst) != 0.0) ? 2 : 1;
+    }
+    if (ns == 0) s = 0.0;
+    
+    collect_shifts(T, ns, max_shifts, shifts);
+    
+    int deflated = nw - ns;
+    if (deflated == 0 && s != 0.0) return 0;  // 収縮できなければ H は変更しない
+    
+    // 残ったスパイクを鏡映で1成分にまとめ, 未収縮部分をヘッセンベルグ形に戻す
+    if (ns > 1 && s != 0.0) {
+        vector<double> spike(ns);
+        for (int i = 0; i < ns; ++i) spike[i] = s * V(1, i+1);
+        double beta = spike[0];
+        double tau = make_reflector(beta, &spike[1], ns);
+        spike[0] = 1.0;
+        
+        if (tau != 0.0) {
+            for (int j = 1; j <= nw; ++j) {
+                double sum = 0.0;
+                for (int i = 0; i < ns; ++i) sum += spike[i] * T(i+1, j);
+                sum *= tau;
+                for (int i = 0; i < ns; ++i) T(i+1, j) -= sum * spike[i];
+            }
+            for (int i = 1; i <= ns; ++i) {
+                double sum = 0.0;
+                for (int j = 0; j < ns; ++j) sum += T(i, j+1) * spike[j];
+                sum *= tau;
+                for (int j = 0; j < ns; ++j) T(i, j+1) -= sum * spike[j];
+            }
+            for (int i = 1; i <= nw; ++i) {
+                double sum = 0.0;
+                for (int j = 0; j < ns; ++j) sum += V(i, j+1) * spike[j];
+                sum *= tau;
+                for (int j = 0; j < ns; ++j) V(i, j+1) -= sum * spike[j];
+            }
+        }
+        reduce_to_hessenberg(T, 1, ns, &V);
+    }
+    
+    // 窓を書き戻す
+    if (kwtop > lo) H(kwtop, kwtop-1) = s * V(1, 1);
+    for (int i = 1; i <= nw; ++i) {
+        for (int j = 1; j <= nw; ++j) {
+            H(kwtop+i-1, kwtop+j-1) = (j >= i - 1) ? T(i, j) : 0.0;
+        }
+    }
+    
+    // 窓の外側に変換を適用する (窓の上の行, 右の列, 累積行列)
+    int i1 = w.wantt ? 1 : lo;
+    vector<double> row(nw);
+    for (int i = i1; i < kwtop; ++i) {
+        for (int j = 1; j <= nw; ++j) {
+            double sum = 0.0;
+            for (int k = 1; k <= nw; ++k) sum += H(i, kwtop+k-1) * V(k, j);
+            row[j-1] = sum;
+        }
+        for (int j = 1; j <= nw; ++j) H(i, kwtop+j-1) = row[j-1];
+    }
+    if (w.wantt) {
+        for (int j = hi + 1; j <= n; ++j) {
+            for (int i = 1; i <= nw; ++i) {
+                double sum = 0.0;
+                for (int k = 1; k <= nw; ++k) sum += V(k, i) * H(kwtop+k-1, j);
+                row[i-1] = sum;
+            }
+            for (int i = 1; i <= nw; ++i) H(kwtop+i-1, j) = row[i-1];
+        }
+    }
+    if (w.Z) {
+        Matrix& Z = *w.Z;
+        for (int i = 1; i <= Z.row(); ++i) {
+            for (int j = 1; j <= nw; ++j) {
+                double sum = 0.0;
+                for (int k = 1; k <= nw; ++k) sum += Z(i, kwtop+k-1) * V(k, j);
+                row[j-1] = sum;
+            }
+            for (int j = 1; j <= nw; ++j) Z(i, kwtop+j-1) = row[j-1];
+        }
+    }
+    
+    return deflated;
+}
+
+// 2x2 ブロック H(k..k+1, k..k+1) の標準化 (LAPACK の dlanv2 に準じる)
+// 固有値が実数なら回転で上三角にし, 複素共役なら対角要素を等しく副対角要素を異符号にそろえる.
+// 回転は w.wantt に応じた範囲の行・列と累積行列にも適用し, 2つの固有値を返す
+static pair<complex<double>, complex<double>> standardize_schur_block(Matrix& H, int k, const QRWork& w) {
+    double a = H(k, k), b = H(k, k+1), c = H(k+1, k), d = H(k+1, k+1);
+    double cs = 1.0, sn = 0.0;
+    
+    if (c == 0.0) {
+        // すでに上三角
+    } else if (b == 0.0) {
+        // 行と列を入れ替える
+        cs = 0.0;
+        sn = 1.0;
+        swap(a, d);
+        b = -c;
+        c = 0.0;
+    } else if (a - d == 0.0 && (b > 0.0) != (c > 0.0)) {
+        // すでに標準形の複素共役ブロック
+    } else {
+        double temp = a - d;
+        double p = 0.5 * temp;
+        double bcmax = max(abs(b), abs(c));
+        double bcmis = min(abs(b), abs(c)) * copysign(1.0, b) * copysign(1.0, c);
+        double scale = max(abs(p), bcmax);
+        double z = p / scale * p + bcmax / scale * bcmis;
+        
+        if (z >= 4.0 * numeric_limits<double>::epsilon()) {
+            // 実固有値: 上三角にする
+            z = p + copysign(sqrt(scale) * sqrt(z), p);
+            a = d + z;
+            d = d - bcmax / z * bcmis;
+            double tau = hypot(c, z);
+            cs = z / tau;
+            sn = c / tau;
+            b = b - c;
+            c = 0.0;
+        } else {
+            // 複素固有値か近接した実固有値: 対角要素を等しくする
+            double sigma = b + c;
+            double tau = hypot(sigma, temp);
+            cs = sqrt(0.5 * (1.0 + abs(sigma) / tau));
+            sn = -(p / (tau * cs)) * copysign(1.0, sigma);
+            
+            double aa = a * cs + b * sn, bb = -a * sn + b * cs;
+            double cc = c * cs + d * sn, dd = -c * sn + d * cs;
+            a = aa * cs + cc * sn;
+            b = bb * cs + dd * sn;
+            c = -aa * sn + cc * cs;
+            d = -bb * sn + dd * cs;
+            
+            temp = 0.5 * (a + d);
+            a = d = temp;
+            if (c != 0.0) {
+                if (b != 0.0) {
+                    if ((b > 0.0) == (c > 0.0)) {
+                        // 実固有値だったので上三角にする
+                        double sab = sqrt(abs(b)), sac = sqrt(abs(c));
+                        p = copysign(sab * sac, c);
+                        tau = 1.0 / sqrt(abs(b + c));
+                        a = temp + p;
+                        d = temp - p;
+                        b = b - c;
+                        c = 0.0;
+                        double cs1 = sab * tau, sn1 = sac * tau;
+                        temp = cs * cs1 - sn * sn1;
+                        sn = cs * sn1 + sn * cs1;
+                        cs = temp;
+                    }
+                } else {
+                    b = -c;
+                    c = 0.0;
+                    temp = cs;
+                    cs = -sn;
+                    sn = temp;
+                }
+            }
+        }
+    }
+    
+    H(k, k) = a;
+    H(k, k+1) = b;
+    H(k+1, k) = c;
+    H(k+1, k+1) = d;
+    
+    // 回転をブロックの外側に適用する
+    if (cs != 1.0 || sn != 0.0) {
+        int i1 = w.wantt ? 1 : k;
+        int i2 = w.wantt ? H.row() : k + 1;
+        for (int j = k + 2; j <= i2; ++j) {
+            double x = H(k, j), y = H(k+1, j);
+            H(k, j) = cs * x + sn * y;
+            H(k+1, j) = cs * y - sn * x;
+        }
+        for (int i = i1; i < k; ++i) {
+            double x = H(i, k), y = H(i, k+1);
+            H(i, k) = cs * x + sn * y;
+            H(i, k+1) = cs * y - sn * x;
+        }
+        if (w.Z) {
+            Matrix& Z = *w.Z;
+            for (int i = 1; i <= Z.row(); ++i) {
+                double x = Z(i, k), y = Z(i, k+1);
+                Z(i, k) = cs * x + sn * y;
+                Z(i, k+1) = cs * y - sn * x;
+            }
+        }
+    }
+    
+    if (c == 0.0) return make_pair(complex<double>(a, 0), complex<double>(d, 0));
+    double wi = sqrt(abs(b)) * sqrt(abs(c));
+    return make_pair(complex<double>(a, wi), complex<double>(d, -wi));
+}
+
+// AED を使う窓の最小サイズ
+static const int aed_min_size = 75;
+
+// 窓のサイズ nh に対する1スイープあたりのシフト数 (LAPACK の推奨値に準じる)
+static int recommended_shift_count(int nh) {
+    int ns;
+    if (nh < 30) ns = 2;
+    else if (nh < 60) ns = 4;
+    else if (nh < 150) ns = 10;
+    else if (nh < 590) ns = max(10, nh / (int)lround(log2((double)nh)));
+    else if (nh < 3000) ns = 64;
+    else if (nh < 6000) ns = 128;
+    else ns = 256;
+    return max(2, ns - ns % 2);
+}
+
+// QR反復の本体
+// H(lo_bound..hi, lo_bound..hi) を反復し, 分離した固有値を下から順に eigenvalues に追加する
+// 収束しなかった窓があれば false を返す
+static bool qr_iterate(Matrix& H, int lo_bound, int hi, const QRWork& w,
+                       vector<complex<double>>& eigenvalues, vector<int>* iteration_counts) {
+    bool converged = true;
+    int iteration_count = 0;
+    vector<pair<double, double>> shifts;
+    
+    // 能動窓 [lo, hi] だけを反復する. 途中の副対角要素が無視できれば
+    // そこで H を分割し, 下側の独立な部分問題から順に処理する
+    while (hi >= lo_bound) {
+        int lo = hi;
+        while (lo > lo_bound && abs(H(lo, lo-1)) >= w.tolerance) lo--;
+        if (lo > lo_bound) H(lo, lo-1) = 0.0;
+        
+        if (lo == hi) {
+            eigenvalues.push_back(complex<double>(H(hi, hi), 0));
+            if (iteration_counts) iteration_counts->push_back(iteration_count);
+            hi--;
+            iteration_count = 0;
+            continue;
+        }
+        
+        if (lo == hi - 1) {
+            // 実Schur形を作るときは 2x2 ブロックを標準化する
+            pair<complex<double>, complex<double>> vals =
+                w.wantt ? standardize_schur_block(H, lo, w) : eigenvalues_2x2(H, lo);
+            eigenvalues.push_back(vals.first);
+            eigenvalues.push_back(vals.second);
+            if (iteration_counts) iteration_counts->insert(iteration_counts->end(), 2, iteration_count);
+            hi -= 2;
+            iteration_count = 0;
+            continue;
+        }
+        
+        if (iteration_count >= w.max_iterations) {
+            // 未収束の窓は対角要素を近似値として返し, 残りの部分問題を続ける
+            converged = false;
+            for (int i = hi; i >= lo; --i) {
+                eigenvalues.push_back(complex<double>(H(i, i), 0));
+                if (iteration_counts) iteration_counts->push_back(iteration_count);
+            }
+            hi = lo - 1;
+            iteration_count = 0;
+            continue;
+        }
+        
+        int nh = hi - lo + 1;
+        bool exceptional = iteration_count > 0 && iteration_count % 10 == 0;
+        
+        if (w.strategy != QR_FRANCIS && nh >= aed_min_size && !exceptional) {
+            // 収束が停滞したら窓を広げる
+            int ns = recommended_shift_count(nh);
+            int nw = (nh <= 500) ? ns : 3 * ns / 2;
+            if (iteration_count >= 5) nw *= 2;
+            nw = min(nw, nh);
+            
+            int deflated = aggressive_early_deflation(H, lo, hi, nw, ns, w, shifts);
+            iteration_count++;
+            
+            // 十分に収縮できたなら次のAEDへ. そうでなければ残りの固有値をシフトとして一括投入する
+            if (deflated > 0 && deflated * 100 > 14 * nw) continue;
+            int hi_sweep = hi - deflated;
+            if (hi_sweep - lo + 1 < 3) continue;
+            if (!shifts.empty()) {
+                if (w.strategy == QR_MULTISHIFT) {
+                    multishift_sweep(H, lo, hi_sweep, shifts, w);
+                } else {
+                    for (size_t i = 0; i < shifts.size(); ++i) {
+                        francis_double_step(H, lo, hi_sweep, shifts[i].first, shifts[i].second, w);
+                    }
+                }
+                continue;
+            }
+        }
+        
+        // シフトは窓の末尾2x2ブロックの2つの固有値. 10回ごとに例外シフトで停滞を避ける
+        double shift_sum, shift_prod;
+        if (exceptional) {
+            double s = abs(H(hi, hi-1)) + abs(H(hi-1, hi-2));
+            double h11 = 0.75 * s + H(hi, hi);
+            shift_sum = 2.0 * h11;
+            shift_prod = h11 * h11 + 0.4375 * s * s;
+        } else {
+            shift_sum = H(hi-1, hi-1) + H(hi, hi);
+            shift_prod = H(hi-1, hi-1) * H(hi, hi) - H(hi-1, hi) * H(hi, hi-1);
+        }
+        
+        francis_double_step(H, lo, hi, shift_sum, shift_prod, w);
+        iteration_count++;
+    }
+    
+    return converged;
+}
+
+// ダブルQR法による固有値計算
+// max_iterations は固有値1つ(または2x2ブロック1つ)を分離するまでの反復回数の上限
+// iteration_counts を渡すと, 各固有値の分離に要した反復回数を固有値と同じ順に格納する
+// H をヘッセンベルグ化してQR反復し, 固有値を eigenvalues に追加する (H は上書きされる)
+static void double_qr(Matrix& H, HessenbergWork& work, int max_iterations, double tolerance,
+                      vector<int>* iteration_counts, QRStrategy strategy, vector<complex<double>>& eigenvalues) {
+    int n = H.row();
+    if (iteration_counts) iteration_counts->clear();
+    
+    hessenberg_reduction(H, work);
+    
+    double initial_norm = matrix_norm(H);
+    if (initial_norm < 1e-14) {
+        for (int i = 1; i <= n; ++i) {
+            eigenvalues.push_back(complex<double>(0.0, 0.0));
+        }
+        if (iteration_counts) iteration_counts->assign(n, 0);
+        return;
+    }
+    
+    QRWork w;
+    w.tolerance = tolerance * initial_norm;
+    w.max_iterations = max_iterations;
+    w.strategy = strategy;
+    w.wantt = false;
+    w.Z = nullptr;
+    
+    if (!qr_iterate(H, 1, n, w, eigenvalues, iteration_counts)) {
+        cout << "警告: 最大反復回数に達しました" << endl;
+    }
+}
+
+vector<complex<double>> eigenvalues_double_qr(Matrix A, int max_iterations, double tolerance,
+                                              vector<int>* iteration_counts, QRStrategy strategy) {
+    vector<complex<double>> eigenvalues;
+    HessenbergWork work;
+    double_qr(A, work, max_iterations, tolerance, iteration_counts, strategy, eigenvalues);
+    return eigenvalues;
+}
+
+// 実Schur分解
+// ヘッセンベルグ化の直交行列を Z の初期値とし, QR反復の変換をすべて右から累積する
+// 収束しなかった場合は false を返す
+bool schur_decomposition(Matrix& A, Matrix& Z, int max_iterations, double tolerance, QRStrategy strategy) {
+    int n = A.row();
+    Matrix& H = A;
+    hessenberg_reduction(H, &Z);
+    
+    double initial_norm = matrix_norm(H);
+    if (initial_norm < 1e-14) {
+        for (int i = 1; i < n; ++i) H(i+1, i) = 0.0;
+        return true;
+    }
+    
+    QRWork w;
+    w.tolerance = tolerance * initial_norm;
+    w.max_iterations = max_iterations;
+    w.strategy = strategy;
+    w.wantt = true;
+    w.Z = &Z;
+    
+    vector<complex<double>> unused;
+    if (!qr_iterate(H, 1, n, w, unused, nullptr)) {
+        cout << "警告: 最大反復回数に達しました" << endl;
+        return false;
+    }
+    return true;
+}
+
+// 準上三角行列 T の右固有ベクトルを後退代入で求め, Schurベクトル Z で元の基底に戻す
+// (LAPACK の dtrevc に準じる). 固有ベクトル1本あたり O(n^2), 全体で O(n^3)
+// 複素共役対 (k-1, k) では X の k-1 列に実部, k 列に虚部を置く
+static void schur_eigenvectors(const Matrix& T, const Matrix& Z, Matrix& vr, Matrix& vi) {
+    int n = T.row();
+    double smin = max(matrix_norm(T) * numeric_limits<double>::epsilon(), numeric_limits<double>::min());
+    const double big = 1e100;
+    
+    vector<double> X((size_t)n * n, 0.0);   // 0始まり行優先
+    vector<int> xlo(n, 0), xhi(n);          // X の各列で非零になりうる行の範囲
+    vector<complex<double>> x(n + 1);
+    
+    for (int k = n; k >= 1; ) {
+        bool pair = k > 1 && T(k, k-1) != 0.0;
+        int top = pair ? k - 1 : k;
+        for (int i = 1; i <= n; ++i) x[i] = 0.0;
+        
+        // 対角ブロックの固有ベクトルを初期値とする
+        complex<double> lambda;
+        if (!pair) {
+            lambda = T(k, k);
+            x[k] = 1.0;
+        } else {
+            double wi = sqrt(abs(T(k-1, k))) * sqrt(abs(T(k, k-1)));
+            lambda = complex<double>(T(k, k), wi);
+            if (abs(T(k-1, k)) >= abs(T(k, k-1))) {
+                x[k-1] = 1.0;
+                x[k] = complex<double>(0.0, wi / T(k-1, k));
+            } else {
+                x[k-1] = -wi / T(k, k-1);
+                x[k] = complex<double>(0.0, 1.0);
+            }
+        }
+        for (int i = 1; i < top; ++i) {
+            for (int j = top; j <= k; ++j) x[i] -= T(i, j) * x[j];
+        }
+        
+        // (T - lambda I) x = 0 を上のブロックへ向かって解く
+        for (int j = top - 1; j >= 1; ) {
+            int jtop = j;
+            if (j > 1 && T(j, j-1) != 0.0) {
+                jtop = j - 1;
+                complex<double> a11 = T(j-1, j-1) - lambda, a12 = T(j-1, j);
+                complex<double> a21 = T(j, j-1), a22 = T(j, j) - lambda;
+                complex<double> det = a11 * a22 - a12 * a21;
+                if (abs(det) < smin) det = smin;
+                complex<double> x1 = (a22 * x[j-1] - a12 * x[j]) / det;
+                complex<double> x2 = (a11 * x[j] - a21 * x[j-1]) / det;
+                x[j-1] = x1;
+                x[j] = x2;
+            } else {
+                complex<double> d = T(j, j) - lambda;
+                if (abs(d) < smin) d = smin;
+                x[j] /= d;
+            }
+            
+            // 桁あふれを避けるため, 大きくなりすぎたらベクトル全体を縮小する
+            double xmax = max(abs(x[jtop]), abs(x[j]));
+            if (xmax > big) {
+                for (int i = 1; i <= k; ++i) x[i] /= xmax;
+            }
+            
+            for (int i = 1; i < jtop; ++i) {
+                for (int q = jtop; q <= j; ++q) x[i] -= T(i, q) * x[q];
+            }
+            j = jtop - 1;
+        }
+        
+        for (int i = 1; i <= k; ++i) {
+            X[(size_t)(i-1) * n + (top-1)] = x[i].real();
+            if (pair) X[(size_t)(i-1) * n + (k-1)] = x[i].imag();
+        }
+        xhi[top-1] = xhi[k-1] = k - 1;
+        k = top - 1;
+    }
+    
+    // V = Z X
+    vector<double> Zbuf((size_t)n * n), V((size_t)n * n);
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) Zbuf[(size_t)i * n + j] = Z(i+1, j+1);
+    }
+    block_multiply(&Zbuf[0], &X[0], &V[0], n, n, n, &xlo[0], &xhi[0]);
+    
+    vr = Matrix(n);
+    vi = Matrix(n);
+    for (int k = 1; k <= n; ++k) {
+        bool pair = k < n && T(k+1, k) != 0.0;
+        double sum = 0.0;
+        for (int i = 0; i < n; ++i) {
+            double re = V[(size_t)i * n + (k-1)];
+            double im = pair ? V[(size_t)i * n + k] : 0.0;
+            sum += re * re + im * im;
+        }
+        double scale = (sum > 0.0) ? 1.0 / sqrt(sum) : 0.0;
+        for (int i = 0; i < n; ++i) {
+            vr(i+1, k) = V[(size_t)i * n + (k-1)] * scale;
+            if (pair) {
+                vi(i+1, k) = V[(size_t)i * n + k] * scale;
+                vr(i+1, k+1) = vr(i+1, k);
+                vi(i+1, k+1) = -vi(i+1, k);
+            }
+        }
+        if (pair) k++;
+    }
+}
+
+// ダブルQR法による固有値と右固有ベクトルの計算
+// 固有値は Schur形 T の対角に沿って上から順に返し, 複素共役対は虚部が正のものを先に置く
+// QR反復が収束しなかった場合は空の固有値を返し, vr, vi も空にする
+vector<complex<double>> eigenvectors_double_qr(Matrix A, Matrix& vr, Matrix& vi,
+                                               int max_iterations, double tolerance, QRStrategy strategy) {
+    int n = A.row();
+    Matrix& T = A;
+    Matrix Z(n);
+    vector<complex<double>> eigenvalues;
+    if (!schur_decomposition(T, Z, max_iterations, tolerance, strategy)) {
+        // 収束しなかった Schur形から固有ベクトルは作らない (警告は schur_decomposition が出力済み)
+        vr = Matrix(0);
+        vi = Matrix(0);
+        return eigenvalues;
+    }
+    
+    for (int k = 1; k <= n; ++k) {
+        if (k < n && T(k+1, k) != 0.0) {
+            double wi = sqrt(abs(T(k, k+1))) * sqrt(abs(T(k+1, k)));
+            eigenvalues.push_back(complex<double>(T(k, k), wi));
+            eigenvalues.push_back(complex<double>(T(k, k), -wi));
+            k++;
+        } else {
+            eigenvalues.push_back(complex<double>(T(k, k), 0));
+        }
+    }
+    
+    schur_eigenvectors(T, Z, vr, vi);
+    return eigenvalues;
+}
+
+// 対称行列の判定
+bool is_symmetric(const Matrix& A, double tolerance) {
+    int n = A.row();
+    if (A.col() != n) return false;
+    double limit = tolerance * matrix_norm(A);
+    for (int i = 1; i <= n; ++i) {
+        for (int j = 1; j < i; ++j) {
+            if (abs(A(i, j) - A(j, i)) > limit) return false;
+        }
+    }
+    return true;
+}
+
+// 対称行列の三重対角化
+// k 列目の鏡映 P = I - tau v v^T を対称な階数2の更新 A <- A - v w^T - w v^T
+// (p = tau A v, w = p - (tau/2)(p^T v) v) として適用する. 計算量は O(n^3)
+void tridiagonal_reduction(Matrix& A, vector<double>& d, vector<double>& e, Matrix* Qt) {
+    int n = A.row();
+    d.assign(n, 0.0);
+    e.assign(max(n - 1, 0), 0.0);
+    
+    // 上三角部分を下三角部分で揃える
+    for (int i = 1; i <= n; ++i) {
+        for (int j = i + 1; j <= n; ++j) A(i, j) = A(j, i);
+    }
+    
+    // 丸め誤差よりはるかに小さい列は消去済みとみなす (hessenberg_reduction と同じ)
+    double eps = numeric_limits<double>::epsilon();
+    double negligible = eps * eps * matrix_norm(A);
+    
+    vector<double> taus(max(n - 2, 0), 0.0);
+    vector<double> v(n), p(n);
+    for (int k = 1; k <= n - 2; ++k) {
+        int m = n - k;   // 鏡映の長さ (k+1..n 行)
+        double alpha = A(k+1, k);
+        for (int i = 1; i < m; ++i) v[i] = A(k+1+i, k);
+        double tau = make_reflector(alpha, &v[1], m, negligible);
+        v[0] = 1.0;
+        taus[k-1] = tau;
+        e[k-1] = alpha;
+        
+        // 鏡映ベクトルは後で Qt を作るために k 列目の副対角より下に残す
+        for (int i = 1; i < m; ++i) A(k+1+i, k) = v[i];
+        if (tau == 0.0) continue;
+        
+        // p = tau A(k+1..n, k+1..n) v (行ごとの内積で連続アクセス)
+        double pv = 0.0;
+        for (int i = 0; i < m; ++i) {
+            double sum = 0.0;
+            for (int j = 0; j < m; ++j) sum += A(k+1+i, k+1+j) * v[j];
+            p[i] = tau * sum;
+            pv += p[i] * v[i];
+        }
+        double K = -0.5 * tau * pv;
+        for (int i = 0; i < m; ++i) p[i] += K * v[i];
+        
+        for (int i = 0; i < m; ++i) {
+            double vi = v[i], wi = p[i];
+            for (int j = 0; j < m; ++j) A(k+1+i, k+1+j) -= vi * p[j] + wi * v[j];
+        }
+    }
+    
+    for (int i = 1; i <= n; ++i) d[i-1] = A(i, i);
+    if (n >= 2) e[n-2] = A(n, n-1);
+    
+    // Qt = P_{n-2} ... P_1 を行方向の連続アクセスで作る
+    if (Qt) {
+        *Qt = create_identity(n);
+        vector<double> wrow(n);
+        for (int k = 1; k <= n - 2; ++k) {
+            double tau = taus[k-1];
+            if (tau == 0.0) continue;
+            int m = n - k;
+            v[0] = 1.0;
+            for (int i = 1; i < m; ++i) v[i] = A(k+1+i, k);
+            
+            // wrow = v^T Qt(k+1..n, 2..n), Qt(k+1..n, 2..n) -= tau v wrow
+            for (int j = 2; j <= n; ++j) wrow[j-1] = 0.0;
+            for (int i = 0; i < m; ++i) {
+                double vi = v[i];
+                for (int j = 2; j <= n; ++j) wrow[j-1] += vi * (*Qt)(k+1+i, j);
+            }
+            for (int i = 0; i < m; ++i) {
+                double tv = tau * v[i];
+                for (int j = 2; j <= n; ++j) (*Qt)(k+1+i, j) -= tv * wrow[j-1];
+            }
+        }
+    }
+}
+
+// 対称三重対角行列の陰的QR法
+// 能動窓 [lo, hi] に対し, 末尾2x2のWilkinsonシフトで始めたバルジをGivens回転で追跡する.
+// 1反復の計算量は固有値のみなら O(hi-lo), 固有ベクトルも累積するなら O(n(hi-lo))
+bool tridiagonal_qr(vector<double>& d, vector<double>& e, Matrix* Zt, int max_iterations) {
+    int n = (int)d.size();
+    const double eps = numeric_limits<double>::epsilon();
+    bool converged = true;
+    int iteration_count = 0;
+    
+    // 副対角要素は隣接する対角要素に対して相対的に判定し, 行列全体に比べて
+    // eps^2 倍より小さいものは (非正規化数での停滞を避けるため) 無条件に無視する
+    double tnorm = 0.0;
+    for (int i = 0; i < n; ++i) tnorm = max(tnorm, abs(d[i]));
+    for (int i = 0; i < n - 1; ++i) tnorm = max(tnorm, abs(e[i]));
+    double floor_tol = eps * eps * tnorm;
+    
+    int hi = n - 1;
+    while (hi > 0) {
+        // 無視できる副対角要素で分割する
+        int lo = hi;
+        while (lo > 0 && abs(e[lo-1]) > max(eps * (abs(d[lo-1]) + abs(d[lo])), floor_tol)) lo--;
+        if (lo > 0) e[lo-1] = 0.0;
+        
+        if (lo == hi) {
+            hi--;
+            iteration_count = 0;
+            continue;
+        }
+        if (iteration_count >= max_iterations) {
+            converged = false;
+            for (int i = lo; i < hi; ++i) e[i] = 0.0;
+            hi = lo - 1;
+            iteration_count = 0;
+            continue;
+        }
+        
+        // Wilkinsonシフト: 末尾2x2ブロックの固有値のうち d[hi] に近い方
+        double t = 0.5 * (d[hi-1] - d[hi]);
+        double mu = d[hi] - e[hi-1] * e[hi-1] / (t + copysign(hypot(t, e[hi-1]), t));
+        
+        double x = d[lo] - mu;
+        double z = e[lo];
+        for (int k = lo; k < hi; ++k) {
+            double c = 1.0, s = 0.0;
+            if (z != 0.0) {
+                if (abs(z) > abs(x)) {
+                    double tau = -x / z;
+                    s = 1.0 / sqrt(1.0 + tau * tau);
+                    c = s * tau;
+                } else {
+                    double tau = -z / x;
+                    c = 1.0 / sqrt(1.0 + tau * tau);
+                    s = c * tau;
+                }
+            }
+            if (k > lo) e[k-1] = c * x - s * z;
+            
+            double d1 = d[k], d2 = d[k+1], ek = e[k];
+            d[k] = c * c * d1 - 2.0 * c * s * ek + s * s * d2;
+            d[k+1] = s * s * d1 + 2.0 * c * s * ek + c * c * d2;
+            e[k] = c * s * (d1 - d2) + (c * c - s * s) * ek;
+            if (k < hi - 1) {
+                x = e[k];
+                z = -s * e[k+1];
+                e[k+1] *= c;
+            }
+            
+            if (Zt) {
+                Matrix& Q = *Zt;
+                for (int j = 1; j <= Q.col(); ++j) {
+                    double a = Q(k+1, j), b = Q(k+2, j);
+                    Q(k+1, j) = c * a - s * b;
+                    Q(k+2, j) = s * a + c * b;
+                }
+            }
+        }
+        iteration_count++;
+    }
+    
+    // 昇順に並べ替える (固有ベクトルの行も一緒に入れ替える)
+    for (int i = 0; i < n - 1; ++i) {
+        int kmin = i;
+        for (int k = i + 1; k < n; ++k) {
+            if (d[k] < d[kmin]) kmin = k;
+        }
+        if (kmin == i) continue;
+        swap(d[i], d[kmin]);
+        if (Zt) {
+            Matrix& Q = *Zt;
+            for (int j = 1; j <= Q.col(); ++j) swap(Q(i+1, j), Q(kmin+1, j));
+        }
+    }
+    
+    return converged;
+}
+
+// 対称行列の固有値計算 (三重対角化 + 陰的QR法)
+// 固有ベクトルは転置した形 (行) で累積し, 最後に列へ並べ直す
+vector<double> eigenvalues_symmetric(Matrix A, Matrix* eigenvectors, int max_iterations) {
+    vector<double> d, e;
+    Matrix Zt;
+    tridiagonal_reduction(A, d, e, eigenvectors ? &Zt : nullptr);
+    
+    if (!tridiagonal_qr(d, e, eigenvectors ? &Zt : nullptr, max_iterations)) {
+        cout << "警告: 最大反復回数に達しました" << endl;
+    }
+    
+    if (eigenvectors) *eigenvectors = trans(Zt);
+    return d;
+}
+
+// 帯行列として格納した (B - σI) の部分ピボット付き LU 分解
+// B は上ヘッセンベルグ行列か三重対角行列で, 行 i には i-1 列目から width 個の要素を持つ
+// (三重対角行列なら width = 4 でピボット選択による2本目の上副対角の fill-in も収まる. k+1 行目の
+// last(k) より右は分解の途中でも 0 なので, 行の入れ替えは last(k) 列までで足りる).
+// 隣り合う2行からしかピボットを選ばないので, ヘッセンベルグ行列で O(n^2), 三重対角行列で O(n)
+struct ShiftedBandLU {
+    int n, width;
+    vector<double> a;       // a[i * width + (j - i + 1)] = (i, j) 要素 (0始まり)
+    vector<char> swapped;   // k 行目と k+1 行目を入れ替えたか
+    
+    double& at(int i, int j) { return a[(size_t)i * width + (j - i + 1)]; }
+    int last(int i) const { return min(n - 1, i + width - 2); }
+    
+    // band に σ を引いて分解する. 0 になったピボットは pivmin で置き換える (LAPACK の dlagtf と同じ)
+    void factor(const vector<double>& band, double sigma, double pivmin) {
+        a = band;
+        swapped.assign(n, 0);
+        for (int i = 0; i < n; ++i) at(i, i) -= sigma;
+        for (int k = 0; k < n - 1; ++k) {
+            if (abs(at(k+1, k)) > abs(at(k, k))) {
+                swapped[k] = 1;
+                for (int j = k; j <= last(k); ++j) swap(at(k, j), at(k+1, j));
+            }
+            if (at(k, k) == 0.0) at(k, k) = pivmin;
+            double l = at(k+1, k) / at(k, k);
+            at(k+1, k) = l;
+            for (int j = k + 1; j <= last(k); ++j) at(k+1, j) -= l * at(k, j);
+        }
+        if (n > 0 && at(n-1, n-1) == 0.0) at(n-1, n-1) = pivmin;
+    }
+    
+    // (B - σI) y = b を解き, b を y で上書きする
+    void solve(double* b) {
+        for (int k = 0; k < n - 1; ++k) {
+            if (swapped[k]) swap(b[k], b[k+1]);
+            b[k+1] -= at(k+1, k) * b[k];
+        }
+        for (int i = n - 1; i >= 0; --i) {
+            double sum = b[i];
+            for (int j = i + 1; j <= last(i); ++j) sum -= at(i, j) * b[j];
+            b[i] = sum / at(i, i);
+        }
+    }
+};
+
+// 複数のシフトに対する逆反復法
+// A を一度だけヘッセンベルグ化 (対称なら三重対角化) し, 各シフトの連立方程式はその帯行列の LU 分解で解く.
+// シフトは近いもの (間隔が params::cluster_gap * ||A||_F 以下) をまとめたクラスタ単位でスレッドに分配し,
+// 対称行列ではクラスタ内のベクトルを互いに直交化して同じ固有ベクトルへの収束を防ぐ.
+// 最後に全てのベクトルを元の基底へまとめて戻す. シフトあたりの最大反復回数を返す
+int inverse_iteration_batch(const Matrix& A, const vector<double>& shifts, vector<double>& eigenvalues,
+                            Matrix& vectors, ThreadPool* pool, int max_iterations, double tolerance) {
+    int n = A.row();
+    int m = shifts.size();
+    bool symmetric = is_symmetric(A);
+    double anorm = matrix_norm(A);
+    double pivmin = numeric_limits<double>::epsilon() * max(anorm, numeric_limits<double>::min());
+    
+    // 帯行列 B と, 元の基底へ戻す行列 (X の各行 = Y の各行 * back)
+    int width = symmetric ? 4 : n + 1;
+    vector<double> band((size_t)n * width, 0.0), back((size_t)n * n);
+    if (symmetric) {
+        Matrix T = A, Qt;
+        vector<double> d, e;
+        tridiagonal_reduction(T, d, e, &Qt);
+        for (int i = 0; i < n; ++i) {
+            band[(size_t)i * width + 1] = d[i];
+            if (i > 0) band[(size_t)i * width] = e[i-1];
+            if (i < n - 1) band[(size_t)i * width + 2] = e[i];
+        }
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) back[(size_t)i * n + j] = Qt(i+1, j+1);
+        }
+    } else {
+        Matrix H = A, Q;
+        hessenberg_reduction(H, &Q);
+        for (int i = 0; i < n; ++i) {
+            for (int j = max(i - 1, 0); j < n; ++j) band[(size_t)i * width + (j - i + 1)] = H(i+1, j+1);
+        }
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) back[(size_t)i * n + j] = Q(j+1, i+1);
+        }
+    }
+    
+    // シフトを昇順に並べてクラスタに分ける
+    vector<int> order(m);
+    for (int i = 0; i < m; ++i) order[i] = i;
+    sort(order.begin(), order.end(), [&](int a, int b) { return shifts[a] < shifts[b]; });
+    vector<int> cluster_start;
+    for (int i = 0; i < m; ++i) {
+        if (i == 0 || shifts[order[i]] - shifts[order[i-1]] > params::cluster_gap * anorm) cluster_start.push_back(i);
+    }
+    cluster_start.push_back(m);
+    int clusters = cluster_start.size() - 1;
+    
+    eigenvalues.assign(m, 0.0);
+    vector<double> Y((size_t)m * n);
+    vector<int> iterations(m, 0);
+    vector<char> converged(m, 0);
+    
+    auto run_clusters = [&](int c0, int c1) {
+        ShiftedBandLU lu;
+        lu.n = n;
+        lu.width = width;
+        vector<double> by(n);
+        for (int c = c0; c < c1; ++c) {
+            for (int t = cluster_start[c]; t < cluster_start[c+1]; ++t) {
+                int s = order[t];
+                double* y = &Y[(size_t)s * n];
+                lu.factor(band, shifts[s], pivmin);
+                
+                // 初期ベクトルは乱数 (シフトの番号を種にして, スレッド数によらず同じ結果にする)
+                unsigned long long seed = 0x9E3779B97F4A7C15ULL * (s + 1);
+                for (int i = 0; i < n; ++i) {
+                    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                    y[i] = (double)(seed >> 11) / 9007199254740992.0 - 0.5;
+                }
+                
+                int iter;
+                for (iter = 1; iter <= max_iterations; ++iter) {
+                    lu.solve(y);
+                    
+                    // 同じクラスタで先に求めたベクトルと直交化する (2回)
+                    if (symmetric) {
+                        for (int pass = 0; pass < 2; ++pass) {
+                            for (int u = cluster_start[c]; u < t; ++u) {
+                                const double* q = &Y[(size_t)order[u] * n];
+                                double dot = 0.0;
+                                for (int i = 0; i < n; ++i) dot += q[i] * y[i];
+                                for (int i = 0; i < n; ++i) y[i] -= dot * q[i];
+                            }
+                        }
+                    }
+                    double ynorm = 0.0;
+                    for (int i = 0; i < n; ++i) ynorm += y[i] * y[i];
+                    ynorm = sqrt(ynorm);
+                    for (int i = 0; i < n; ++i) y[i] /= ynorm;
+                    
+                    // レイリー商と残差 ||B y - ρ y||
+                    double rho = 0.0;
+                    for (int i = 0; i < n; ++i) {
+                        double sum = 0.0;
+                        for (int j = max(i - 1, 0); j <= min(n - 1, i + width - 2); ++j) {
+                            sum += band[(size_t)i * width + (j - i + 1)] * y[j];
+                        }
+                        by[i] = sum;
+                        rho += y[i] * sum;
+                    }
+                    double residual = 0.0;
+                    for (int i = 0; i < n; ++i) residual += (by[i] - rho * y[i]) * (by[i] - rho * y[i]);
+                    eigenvalues[s] = rho;
+                    if (sqrt(residual) <= tolerance * anorm) {
+                        converged[s] = 1;
+                        break;
+                    }
+                }
+                iterations[s] = min(iter, max_iterations);
+            }
+        }
+    };
+    if (pool) {
+        pool->parallel_for(0, clusters, 1, run_clusters);
+    } else {
+        run_clusters(0, clusters);
+    }
+    
+    // X = Y * back を行のまとまりごとに並列に計算する
+    vector<double> X((size_t)m * n);
+    auto transform_rows = [&](int r0, int r1) {
+        block_multiply(&Y[(size_t)r0 * n], &back[0], &X[(size_t)r0 * n], r1 - r0, n, n);
+    };
+    if (pool) {
+        pool->parallel_for(0, m, transform_rows);
+    } else {
+        transform_rows(0, m);
+    }
+    
+    vectors = Matrix(n, m);
+    int max_used = 0;
+    bool all_converged = true;
+    for (int s = 0; s < m; ++s) {
+        for (int i = 0; i < n; ++i) vectors(i+1, s+1) = X[(size_t)s * n + i];
+        max_used = max(max_used, iterations[s]);
+        all_converged = all_converged && converged[s];
+    }
+    if (!all_converged) cout << "警告: 最大反復回数に達しました" << endl;
+    return max_used;
+}
+
+// 行ベクトル Qt[first..last-1] (長さ n) を, それより前の行と自身に対して正規直交化する
+// 古典的グラム・シュミットを2回繰り返す. 一次従属になった行は乱数ベクトルで置き換える
+static void orthonormalize_rows(vector<double>& Qt, int first, int last, int n, unsigned long long& seed) {
+    for (int j = first; j < last; ++j) {
+        double* q = &Qt[(size_t)j * n];
+        for (int attempt = 0; attempt < 3; ++attempt) {
+            double before = 0.0;
+            for (int c = 0; c < n; ++c) before += q[c] * q[c];
+            
+            for (int pass = 0; pass < 2; ++pass) {
+                for (int i = 0; i < j; ++i) {
+                    const double* qi = &Qt[(size_t)i * n];
+                    double r = 0.0;
+                    for (int c = 0; c < n; ++c) r += qi[c] * q[c];
+                    for (int c = 0; c < n; ++c) q[c] -= r * qi[c];
+                }
+            }
+            
+            double after = 0.0;
+            for (int c = 0; c < n; ++c) after += q[c] * q[c];
+            if (after > 1e-20 * before && after > 0.0) {
+                double scale = 1.0 / sqrt(after);
+                for (int c = 0; c < n; ++c) q[c] *= scale;
+                break;
+            }
+            
+            // 既存の行の張る空間に含まれていたので乱数で作り直す (線形合同法)
+            for (int c = 0; c < n; ++c) {
+                seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                q[c] = (double)(seed >> 11) / 9007199254740992.0 - 0.5;
+            }
+        }
+    }
+}
+
+// 実Schur形の i 行目から始まる対角ブロックの大きさ
+static int schur_block_size(const Matrix& T, int i) {
+    return (i < T.row() && T(i+1, i) != 0.0) ? 2 : 1;
+}
+
+// 行ベクトルとして並んだ count 本の q に対して z = A q を計算するコールバック
+typedef function<void(const double* Q, double* Z, int count)> BlockApply;
+
+// 部分空間反復 (Rayleigh-Ritz 付きのブロックべき乗法)
+// p = k + 補助ベクトルの幅の基底 Q に対し, Z = A Q を行列積でまとめて計算し,
+// H = Q^T Z の固有分解 (非対称なら実Schur分解) を絶対値の降順に並べて Q, Z を Ritz ベクトルへ回転する.
+// 残差 ||z_j - Q t_j|| が小さい先頭の Ritz ベクトルから固定 (ロック) し, 以後は残りの列だけを反復する.
+// 収束は |λ_{p+1} / λ_j| の速さで, 反復回数を返す
+static int subspace_iteration(const BlockApply& apply_block, int n, bool symmetric, int k,
+                              vector<complex<double>>& eigenvalues, Matrix* vectors, int max_iterations,
+                              double tolerance) {
+    k = min(max(k, 1), n);
+    int p = min(n, max(k + k / 2, k + 5));
+    eigenvalues.clear();
+    
+    // 基底は行ベクトルとして持ち, 内積と更新を連続アクセスにする
+    vector<double> Qt((size_t)p * n), Zt((size_t)p * n), Yt, buf;
+    unsigned long long seed = 12345;
+    for (size_t i = 0; i < Qt.size(); ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        Qt[i] = (double)(seed >> 11) / 9007199254740992.0 - 0.5;
+    }
+    orthonormalize_rows(Qt, 0, p, n, seed);
+    
+    int nlock = 0;
+    double lambda_max = 0.0;
+    vector<complex<double>> ritz;
+    int iter;
+    for (iter = 1; iter <= max_iterations; ++iter) {
+        int na = p - nlock;
+        double* Qa = &Qt[(size_t)nlock * n];
+        double* Za = &Zt[(size_t)nlock * n];
+        
+        // Z_a = A Q_a
+        apply_block(Qa, Za, na);
+        
+        // Rayleigh-Ritz: H = Q_a^T Z_a
+        Matrix T(na), Y(na);
+        for (int a = 0; a < na; ++a) {
+            for (int b = 0; b < na; ++b) {
+                double sum = 0.0;
+                for (int c = 0; c < n; ++c) sum += Qa[(size_t)a * n + c] * Za[(size_t)b * n + c];
+                T(a+1, b+1) = sum;
+            }
+        }
+        
+        ritz.clear();
+        if (symmetric) {
+            for (int a = 1; a <= na; ++a) {
+                for (int b = 1; b < a; ++b) T(a, b) = T(b, a) = 0.5 * (T(a, b) + T(b, a));
+            }
+            Matrix V;
+            vector<double> vals = eigenvalues_symmetric(T, &V);
+            
+            // 絶対値の降順に並べる
+            vector<int> idx(na);
+            for (int a = 0; a < na; ++a) idx[a] = a;
+            sort(idx.begin(), idx.end(), [&](int x, int y) { return abs(vals[x]) > abs(vals[y]); });
+            T = Matrix(na);
+            for (int b = 0; b < na; ++b) {
+                T(b+1, b+1) = vals[idx[b]];
+                for (int a = 1; a <= na; ++a) Y(a, b+1) = V(a, idx[b]+1);
+            }
+        } else {
+            if (!schur_decomposition(T, Y)) break;
+            
+            // 対角ブロックを固有値の絶対値の降順に移動する
+            for (int pos = 1; pos <= na; pos += schur_block_size(T, pos)) {
+                int best = pos;
+                double best_mag = -1.0;
+                for (int i = pos; i <= na; i += schur_block_size(T, i)) {
+                    double mag = (schur_block_size(T, i) == 1) ? abs(T(i, i))
+                        : sqrt(abs(T(i, i) * T(i+1, i+1) - T(i, i+1) * T(i+1, i)));
+                    if (mag > best_mag) {
+                        best = i;
+                        best_mag = mag;
+                    }
+                }
+                int target = pos;
+                if (best != pos) move_schur_block(T, Y, best, target);
+            }
+        }
+        for (int i = 1; i <= na; ) {
+            if (schur_block_size(T, i) == 2) {
+                pair<complex<double>, complex<double>> vals = eigenvalues_2x2(T, i);
+                ritz.push_back(vals.first);
+                ritz.push_back(vals.second);
+                i += 2;
+            } else {
+                ritz.push_back(complex<double>(T(i, i), 0.0));
+                i++;
+            }
+        }
+        lambda_max = max(lambda_max, abs(ritz[0]));
+        
+        // Q_a <- Q_a Y, Z_a <- Z_a Y (行ベクトルでは Y^T を左から掛ける)
+        Yt.resize((size_t)na * na);
+        buf.resize((size_t)na * n);
+        for (int a = 0; a < na; ++a) {
+            for (int b = 0; b < na; ++b) Yt[(size_t)a * na + b] = Y(b+1, a+1);
+        }
+        block_multiply(&Yt[0], Qa, &buf[0], na, na, n);
+        copy(buf.begin(), buf.end(), Qa);
+        block_multiply(&Yt[0], Za, &buf[0], na, na, n);
+        copy(buf.begin(), buf.end(), Za);
+        
+        // 残差 ||z_j - sum_a T(a,j) q_a|| の小さい先頭のブロックを固定する
+        // (非対称なら z_j は固定済みのベクトルの成分も持つので, それも除いて測る)
+        int converged = 0;
+        vector<double> r(n);
+        while (converged < na && nlock + converged < k) {
+            int j = converged + 1;
+            int bs = schur_block_size(T, j);
+            bool ok = true;
+            for (int jj = j; jj < j + bs && ok; ++jj) {
+                const double* z = Za + (size_t)(jj-1) * n;
+                copy(z, z + n, r.begin());
+                for (int a = 0; a < nlock; ++a) {
+                    const double* q = &Qt[(size_t)a * n];
+                    double dot = 0.0;
+                    for (int c = 0; c < n; ++c) dot += q[c] * z[c];
+                    for (int c = 0; c < n; ++c) r[c] -= dot * q[c];
+                }
+                for (int a = 1; a <= min(jj + 1, na); ++a) {
+                    const double* q = Qa + (size_t)(a-1) * n;
+                    double t = T(a, jj);
+                    for (int c = 0; c < n; ++c) r[c] -= t * q[c];
+                }
+                double r2 = 0.0;
+                for (int c = 0; c < n; ++c) r2 += r[c] * r[c];
+                ok = sqrt(r2) <= tolerance * lambda_max;
+            }
+            if (!ok) break;
+            for (int jj = j; jj < j + bs; ++jj) eigenvalues.push_back(ritz[jj-1]);
+            converged += bs;
+        }
+        nlock += converged;
+        if (nlock >= k) break;
+        
+        // 次の基底: 未固定の列を Z_a から作り直し, 固定した列と直交化する
+        copy(Zt.begin() + (size_t)nlock * n, Zt.end(), Qt.begin() + (size_t)nlock * n);
+        orthonormalize_rows(Qt, nlock, p, n, seed);
+    }
+    
+    if (nlock < k) {
+        cout << "警告: 最大反復回数に達しました" << endl;
+        for (int j = 0; nlock + j < k && j < (int)ritz.size(); ++j) eigenvalues.push_back(ritz[j]);
+    }
+    
+    if (vectors) {
+        int m = (int)eigenvalues.size();
+        *vectors = Matrix(n, m);
+        for (int j = 0; j < m; ++j) {
+            for (int i = 0; i < n; ++i) (*vectors)(i+1, j+1) = Qt[(size_t)j * n + i];
+        }
+    }
+    return min(iter, max_iterations);
+}
+
+
+int subspace_iteration(const Matrix& A, int k, vector<complex<double>>& eigenvalues, Matrix* vectors,
+                       int max_iterations, double tolerance) {
+    int n = A.row();
+    // Z = A Q (A の各行を全ベクトルに対して使い回す)
+    BlockApply apply_block = [&A, n](const double* Q, double* Z, int count) {
+        for (int i = 1; i <= n; ++i) {
+            for (int j = 0; j < count; ++j) {
+                const double* q = Q + (size_t)j * n;
+                double sum = 0.0;
+                for (int c = 0; c < n; ++c) sum += A(i, c+1) * q[c];
+                Z[(size_t)j * n + (i-1)] = sum;
+            }
+        }
+    };
+    return subspace_iteration(apply_block, n, is_symmetric(A), k, eigenvalues, vectors, max_iterations, tolerance);
+}
+
+int subspace_iteration(const MatVec& matvec, int n, bool symmetric, int k, vector<complex<double>>& eigenvalues,
+                       Matrix* vectors, int max_iterations, double tolerance) {
+    BlockApply apply_block = [&matvec, n](const double* Q, double* Z, int count) {
+        for (int j = 0; j < count; ++j) matvec(Q + (size_t)j * n, Z + (size_t)j * n);
+    };
+    return subspace_iteration(apply_block, n, symmetric, k, eigenvalues, vectors, max_iterations, tolerance);
+}
+
+// 陰的再出発 Arnoldi / Lanczos 法
+// 行列は積 y = A x でのみ参照し, 長さ n のベクトルを m (= 大きくとも 2k+1, k+20 の大きい方) 本だけ持つ.
+// m 次の Arnoldi 分解 A V = V H + f e_m^T を作り, 射影した小さな H の固有値を既存の密行列QR
+// (対称なら三重対角のQR) で求める. 求めたい k 個以外の Ritz 値をシフトとして H に陰的QRを
+// 施し, 分解を先頭 k 本程度に縮めてから再び m 本まで延ばすことを, 全ての Ritz 対の残差
+// ||f|| |e_m^T y| が tolerance |θ| 以下になるまで繰り返す. 固有値は絶対値の降順で, 再出発の回数を返す
+// (H のQRが収束しなかった場合は固有値を空にして -1 を返す)
+int krylov_eigenvalues(const MatVec& matvec, int n, int k, bool symmetric, vector<complex<double>>& eigenvalues,
+                       Matrix* vr, Matrix* vi, KrylovInfo* info, int max_restarts, double tolerance) {
+    k = min(max(k, 1), n);
+    int m = min(n, max(2 * k + 1, k + 20));
+    eigenvalues.clear();
+    
+    vector<double> V((size_t)m * n), f(n), w(n), h(m), buf;
+    Matrix H(m);
+    int matvecs = 0;
+    unsigned long long seed = 2024;
+    double fnorm = 0.0;
+    
+    // 開始ベクトル (零ベクトルは orthonormalize_rows が乱数ベクトルに置き換える)
+    orthonormalize_rows(V, 0, 1, n, seed);
+    
+    // V の j0 行目から m 本まで Arnoldi 分解を延ばす (再直交化つき古典的グラム・シュミット)
+    auto extend = [&](int j0) {
+        for (int j = j0; j < m; ++j) {
+            matvec(&V[(size_t)j * n], &w[0]);
+            matvecs++;
+            for (int i = 0; i <= j; ++i) h[i] = 0.0;
+            for (int pass = 0; pass < 2; ++pass) {
+                for (int i = 0; i <= j; ++i) {
+                    const double* v = &V[(size_t)i * n];
+                    double dot = 0.0;
+                    for (int c = 0; c < n; ++c) dot += v[c] * w[c];
+                    for (int c = 0; c < n; ++c) w[c] -= dot * v[c];
+                    h[i] += dot;
+                }
+            }
+            for (int i = 0; i <= j; ++i) H(i+1, j+1) = h[i];
+            
+            double beta = 0.0;
+            for (int c = 0; c < n; ++c) beta += w[c] * w[c];
+            beta = sqrt(beta);
+            if (j == m - 1) {
+                f = w;
+                fnorm = beta;
+                break;
+            }
+            
+            double* vnext = &V[(size_t)(j+1) * n];
+            double hnorm = 0.0;
+            for (int i = 0; i <= j; ++i) hnorm = hypot(hnorm, h[i]);
+            if (beta <= numeric_limits<double>::epsilon() * hnorm) {
+                // 不変部分空間に達したので, 直交する乱数ベクトルで続ける
+                H(j+2, j+1) = 0.0;
+                fill(vnext, vnext + n, 0.0);
+                orthonormalize_rows(V, j + 1, j + 2, n, seed);
+            } else {
+                H(j+2, j+1) = beta;
+                for (int c = 0; c < n; ++c) vnext[c] = w[c] / beta;
+            }
+        }
+    };
+    extend(0);
+    
+    vector<complex<double>> theta;
+    Matrix Yr, Yi;
+    vector<int> order;
+    int kw = k;
+    int restart = 0;
+    bool converged = false;
+    while (true) {
+        // 射影行列 H の固有対 (Ritz 値と H の固有ベクトル)
+        theta.clear();
+        if (symmetric) {
+            Matrix Hs(m);
+            for (int i = 1; i <= m; ++i) {
+                Hs(i, i) = H(i, i);
+                if (i < m) Hs(i, i+1) = Hs(i+1, i) = 0.5 * (H(i, i+1) + H(i+1, i));
+            }
+            vector<double> vals = eigenvalues_symmetric(Hs, &Yr);
+            for (int i = 0; i < m; ++i) theta.push_back(complex<double>(vals[i], 0.0));
+            Yi = Matrix(m);
+        } else {
+            theta = eigenvectors_double_qr(H, Yr, Yi);
+            if (theta.empty()) break;   // 射影行列のQRが収束しなかった
+        }
+        
+        // 絶対値の降順 (複素共役対は隣り合うように虚部の正のものを先に)
+        order.resize(m);
+        for (int i = 0; i < m; ++i) order[i] = i;
+        stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            double ma = abs(theta[a]), mb = abs(theta[b]);
+            if (ma != mb) return ma > mb;
+            if (theta[a].real() != theta[b].real()) return theta[a].real() > theta[b].real();
+            return theta[a].imag() > theta[b].imag();
+        });
+        kw = k;
+        if (kw < m && theta[order[kw-1]].imag() != 0.0 && theta[order[kw]] == conj(theta[order[kw-1]])) kw++;
+        
+        // 収束判定: Ritz 対の残差 ||f|| |e_m^T y|
+        converged = true;
+        for (int i = 0; i < kw && converged; ++i) {
+            int c = order[i] + 1;
+            double ym = abs(complex<double>(Yr(m, c), Yi(m, c)));
+            double scale = max(abs(theta[order[i]]), numeric_limits<double>::epsilon());
+            converged = fnorm * ym <= tolerance * scale;
+        }
+        if (converged || m == n || restart == max_restarts) break;
+        restart++;
+        
+        // 不要な Ritz 値をダブルシフトの組にする (実数が1つ余れば使わずに残す)
+        vector<pair<double, double>> shifts;
+        double pending = 0.0;
+        bool has_pending = false;
+        for (int i = kw; i < m; ++i) {
+            complex<double> t = theta[order[i]];
+            if (t.imag() > 0.0) {
+                shifts.push_back(make_pair(2.0 * t.real(), norm(t)));
+            } else if (t.imag() == 0.0) {
+                if (has_pending) {
+                    shifts.push_back(make_pair(pending + t.real(), pending * t.real()));
+                    has_pending = false;
+                } else {
+                    pending = t.real();
+                    has_pending = true;
+                }
+            }
+        }
+        int kk = m - 2 * (int)shifts.size();
+        
+        // H に陰的ダブルシフトQRを施し, 変換を Q に累積する
+        Matrix Q = create_identity(m);
+        QRWork qw;
+        qw.tolerance = 0.0;
+        qw.max_iterations = 0;
+        qw.strategy = QR_FRANCIS;
+        qw.wantt = true;
+        qw.Z = &Q;
+        for (size_t i = 0; i < shifts.size(); ++i) {
+            francis_double_step(H, 1, m, shifts[i].first, shifts[i].second, qw);
+        }
+        
+        // 縮めた分解: V_kk = V Q(:, 1..kk), f = v_{kk+1} H(kk+1, kk) + f Q(m, kk)
+        buf.resize((size_t)(kk + 1) * n);
+        vector<double> Qt((size_t)(kk + 1) * m);
+        for (int a = 0; a <= kk; ++a) {
+            for (int b = 0; b < m; ++b) Qt[(size_t)a * m + b] = Q(b+1, a+1);
+        }
+        block_multiply(&Qt[0], &V[0], &buf[0], kk + 1, m, n);
+        double hk = H(kk+1, kk), qmk = Q(m, kk);
+        for (int c = 0; c < n; ++c) w[c] = buf[(size_t)kk * n + c] * hk + f[c] * qmk;
+        copy(buf.begin(), buf.begin() + (size_t)kk * n, V.begin());
+        
+        for (int i = 1; i <= m; ++i) {
+            for (int j = 1; j <= m; ++j) {
+                if (i > kk || j > kk) H(i, j) = 0.0;
+            }
+        }
+        
+        double beta = 0.0;
+        for (int c = 0; c < n; ++c) beta += w[c] * w[c];
+        beta = sqrt(beta);
+        double* vnext = &V[(size_t)kk * n];
+        H(kk+1, kk) = beta;
+        for (int c = 0; c < n; ++c) vnext[c] = beta > 0.0 ? w[c] / beta : 0.0;
+        orthonormalize_rows(V, kk, kk + 1, n, seed);
+        extend(kk);
+    }
+    
+    if (info) {
+        info->restarts = restart;
+        info->matvecs = matvecs;
+        info->workspace_bytes = ((size_t)(m + 3) * n + (size_t)6 * m * m) * sizeof(double);
+    }
+    if (theta.empty()) return -1;
+    
+    if (!converged && m < n) {
+        cout << "警告: 最大反復回数に達しました" << endl;
+    }
+    
+    for (int i = 0; i < kw; ++i) eigenvalues.push_back(theta[order[i]]);
+    
+    // Ritz ベクトル x = V y
+    if (vr || vi) {
+        Matrix xr(n, kw), xi(n, kw);
+        for (int i = 0; i < kw; ++i) {
+            int col = order[i] + 1;
+            for (int a = 0; a < m; ++a) {
+                double yr = Yr(a+1, col), yi = Yi(a+1, col);
+                if (yr == 0.0 && yi == 0.0) continue;
+                const double* v = &V[(size_t)a * n];
+                for (int c = 0; c < n; ++c) {
+                    xr(c+1, i+1) += yr * v[c];
+                    xi(c+1, i+1) += yi * v[c];
+                }
+            }
+        }
+        if (vr) *vr = xr;
+        if (vi) *vi = xi;
+    }
+    return restart;
+}
+
+// 統合インターフェース
+// 小さな行列は固定サイズの SmallMatrix に写し, ヒープ確保なしで解く
+template <int N>
+static int small_compute_eigenvalues(const Matrix& A, bool symmetric, double* re, double* im) {
+    SmallMatrix<N> S;
+    for (int i = 1; i <= N; ++i) {
+        for (int j = 1; j <= N; ++j) S(i, j) = A(i, j);
+    }
+    if (symmetric) {
+        small_eigenvalues_symmetric(S, re);
+        if (im) fill(im, im + N, 0.0);
+        return N;
+    }
+    complex<double> vals[N];
+    if (!small_eigenvalues(S, vals)) {
+        cout << "警告: 最大反復回数に達しました" << endl;
+    }
+    for (int i = 0; i < N; ++i) {
+        re[i] = vals[i].real();
+        if (im) im[i] = vals[i].imag();
+    }
+    return N;
+}
+
+// 固有値の列を re, im に書き写し, 個数を返す
+static int store_eigenvalues(const vector<complex<double>>& eigenvalues, double* re, double* im) {
+    for (size_t i = 0; i < eigenvalues.size(); ++i) {
+        re[i] = eigenvalues[i].real();
+        if (im) im[i] = eigenvalues[i].imag();
+    }
+    return (int)eigenvalues.size();
+}
+
+// 実数の固有値を1つ書く
+static int store_eigenvalue(double eigenval, double* re, double* im) {
+    re[0] = eigenval;
+    if (im) im[0] = 0.0;
+    return 1;
+}
+
+bool parse_eigen_method(const string& name, EigenMethod& method) {
+    static const struct {
+        const char* name;
+        EigenMethod method;
+    } names[] = {
+        {"qr", EIG_QR}, {"symmetric", EIG_SYMMETRIC}, {"power", EIG_POWER}, {"inverse", EIG_INVERSE},
+        {"rayleigh", EIG_RAYLEIGH}, {"subspace", EIG_SUBSPACE}, {"lanczos", EIG_LANCZOS}, {"arnoldi", EIG_ARNOLDI}
+    };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        if (name == names[i].name) {
+            method = names[i].method;
+            return true;
+        }
+    }
+    return false;
+}
+
+int compute_eigenvalues(const Matrix& A, EigenMethod method, double* re, double* im, double shift, int k) {
+    if ((method == EIG_QR || method == EIG_SYMMETRIC) && A.row() <= params::small_size) {
+        bool symmetric = method == EIG_SYMMETRIC || is_symmetric(A);
+        switch (A.row()) {
+            case 1: return small_compute_eigenvalues<1>(A, symmetric, re, im);
+            case 2: return small_compute_eigenvalues<2>(A, symmetric, re, im);
+            case 3: return small_compute_eigenvalues<3>(A, symmetric, re, im);
+            case 4: return small_compute_eigenvalues<4>(A, symmetric, re, im);
+        }
+    }
+    
+    switch (method) {
+        case EIG_QR:
+            if (!is_symmetric(A)) {
+                // ダブルQR法(全ての固有値を計算)
+                return store_eigenvalues(eigenvalues_double_qr(A), re, im);
+            }
+            // fall through
+        case EIG_SYMMETRIC: {
+            // 対称行列は三重対角化と対称QR法 (全ての固有値が実数)
+            vector<double> vals = eigenvalues_symmetric(A);
+            copy(vals.begin(), vals.end(), re);
+            if (im) fill(im, im + vals.size(), 0.0);
+            return (int)vals.size();
+        }
+        case EIG_POWER: {
+            // べき乗法(最大固有値のみ). 途中経過は表示せず, 収束しなければ固有値を書かずに -1 を返す
+            double eigenval;
+            Vector eigenvec;
+            PowerWorkspace work;
+            if (power_method(A, eigenval, eigenvec, work, params::max_iter, params::eps) < 0) return -1;
+            return store_eigenvalue(eigenval, re, im);
+        }
+        case EIG_INVERSE:
+        case EIG_RAYLEIGH: {
+            // 逆べき乗法(シフト値に最も近い固有値) / レイリー商反復(シフト値を初期値として近くの固有値に収束させる)
+            // 連立方程式が解けなければ固有値を書かずに -1 を返す
+            double eigenval;
+            Vector eigenvec;
+            if (inverse_power_method(A, shift, eigenval, eigenvec,
+                                     method == EIG_RAYLEIGH ? INVERSE_RAYLEIGH : INVERSE_FIXED_SHIFT) < 0) {
+                return -1;
+            }
+            return store_eigenvalue(eigenval, re, im);
+        }
+        case EIG_SUBSPACE: {
+            // 部分空間反復(絶対値の大きい k 個の固有値)
+            vector<complex<double>> eigenvalues;
+            subspace_iteration(A, k, eigenvalues);
+            return store_eigenvalues(eigenvalues, re, im);
+        }
+        case EIG_LANCZOS:
+        case EIG_ARNOLDI: {
+            // 陰的再出発 Lanczos 法 (対称) / Arnoldi 法 (非対称) で絶対値の大きい k 個の固有値
+            vector<complex<double>> eigenvalues;
+            MatrixOperator op(A);
+            krylov_eigenvalues(make_matvec(op), A.row(), k, method == EIG_LANCZOS, eigenvalues);
+            return store_eigenvalues(eigenvalues, re, im);
+        }
+    }
+    return 0;
+}
+
+vector<complex<double>> compute_eigenvalues(const Matrix& A, const string& method, double shift, int k) {
+    vector<complex<double>> eigenvalues;
+    EigenMethod m;
+    if (!parse_eigen_method(method, m)) {
+        cout << "エラー: 未知の計算方法です" << endl;
+        return eigenvalues;
+    }
+    
+    vector<double> re(max(A.row(), k + 1)), im(re.size());
+    int count = compute_eigenvalues(A, m, &re[0], &im[0], shift, k);
+    if (count < 0) return eigenvalues;
+    eigenvalues.resize(count);
+    for (int i = 0; i < count; ++i) eigenvalues[i] = complex<double>(re[i], im[i]);
+    return eigenvalues;
+}
+
+// 繰り返し解くための文脈
+EigenSolver::EigenSolver()
+    : n_(0), anorm_(0.0), factored_shift_(0.0), factored_(false), factorizations_(0) {}
+
+// A が直前の行列と同じなら true を返す. 違えば写して ||A||_F を求め直し, 分解を捨てる
+// (大きさが変わったときだけ領域を取り直す)
+bool EigenSolver::load(const Matrix& A) {
+    int n = A.row();
+    if (n == n_) {
+        bool same = true;
+        for (int i = 1; i <= n && same; ++i) {
+            for (int j = 1; j <= n; ++j) {
+                if (A(i, j) != A_(i, j)) {
+                    same = false;
+                    break;
+                }
+            }
+        }
+        if (same) return true;
+    } else {
+        n_ = n;
+        A_.resize(n, n);
+        lu_.resize(n, n);
+        pivot_.resize(n + 1);
+        rhs_.resize(n);
+    }
+    
+    double sum = 0.0;
+    for (int i = 1; i <= n; ++i) {
+        for (int j = 1; j <= n; ++j) {
+            A_(i, j) = A(i, j);
+            sum += A(i, j) * A(i, j);
+        }
+    }
+    anorm_ = sqrt(sum);
+    factored_ = false;
+    return false;
+}
+
+// (A - σI) x = b を解く. 直前に分解したシフトと同じなら分解を使い回す
+bool EigenSolver::shift_solve(double sigma, const double* b, double* x) {
+    int n = n_;
+    if (!factored_ || sigma != factored_shift_) {
+        for (int i = 1; i <= n; ++i) {
+            for (int j = 1; j <= n; ++j) lu_(i, j) = A_(i, j);
+            lu_(i, i) -= sigma;
+        }
+        LUdcp(lu_, &pivot_[0]);
+        factored_ = true;
+        factored_shift_ = sigma;
+        factorizations_++;
+    }
+    for (int i = 1; i <= n; ++i) rhs_(i) = b[i-1];
+    LUslv(lu_, rhs_, &pivot_[0]);
+    bool finite = true;
+    for (int i = 1; i <= n; ++i) {
+        x[i-1] = rhs_(i);
+        finite = finite && abs(rhs_(i)) <= numeric_limits<double>::max();
+    }
+    return finite;
+}
+
+int EigenSolver::inverse_power_method(const Matrix& A, double shift, double& eigenval, Vector& eigenvec,
+                                      InverseIterationMode mode, int max_iterations, double tolerance, bool verbose) {
+    load(A);
+    MatrixOperator op(A_);
+    EigenSolver* self = this;
+    return ::inverse_power_method(make_matvec(op),
+                                  [self](double sigma, const double* b, double* x) { return self->shift_solve(sigma, b, x); },
+                                  n_, shift, eigenval, eigenvec, inverse_work_, mode, max_iterations, tolerance, verbose,
+                                  anorm_);
+}
+
+const vector<complex<double>>& EigenSolver::eigenvalues_double_qr(const Matrix& A, int max_iterations,
+                                                                  double tolerance, QRStrategy strategy) {
+    int n = A.row();
+    if (H_.row() != n) H_.resize(n, n);
+    for (int i = 1; i <= n; ++i) {
+        for (int j = 1; j <= n; ++j) H_(i, j) = A(i, j);
+    }
+    eigenvalues_.clear();
+    eigenvalues_.reserve(n);
+    double_qr(H_, hessenberg_work_, max_iterations, tolerance, nullptr, strategy, eigenvalues_);
+    return eigenvalues_;
 }
\ No newline at end of file
@@ -2,28 +2,278 @@
 #define _eigenvalue_methods_h
 
 #include "../pch.h"
+#include "gemm.h"
+#include "linear_operator.h"
+#include "small_matrix.h"
+#include "thread_pool.h"
+#include <algorithm>
 #include <complex>
+#include <functional>
+#include <limits>
 #include <vector>
 
 // べき乗法による最大固有値計算
 void power_method(const Matrix& A, double& eigenval, Vector& eigenvec);
 
+// べき乗法の作業領域 (呼び出し側で使い回せば反復中のヒープ確保がなくなる)
+struct PowerWorkspace {
+    std::vector<double> x, y;
+};
+
+// 作業領域を使うべき乗法. 反復回数を返し, max_iterations 回で収束しなければ最後の推定値を入れて -1 を返す.
+// verbose なら途中経過と警告を表示する
+int power_method(const Matrix& A, double& eigenval, Vector& eigenvec, PowerWorkspace& work,
+                 int max_iterations = 100, double tolerance = 1e-10, bool verbose = false);
+
+// 行列ベクトル積 matvec だけを使うべき乗法 (n は次元)
+int power_method(const MatVec& matvec, int n, double& eigenval, Vector& eigenvec, PowerWorkspace& work,
+                 int max_iterations = 100, double tolerance = 1e-10, bool verbose = false);
+
 // 逆べき乗法による特定の固有値計算
 void inverse_power_method(const Matrix& A, double shift, double& eigenval, Vector& eigenvec);
 
+// 逆反復法のシフトの選び方
+enum InverseIterationMode {
+    INVERSE_FIXED_SHIFT,  // シフトを固定する (1次収束)
+    INVERSE_RAYLEIGH      // シフトを毎回レイリー商に更新する (対称行列なら3次収束)
+};
+
+// シフトを選べる逆反復法. 残差 ||A x - λ x|| が tolerance * ||A||_F 以下になれば止め, 反復回数を返す
+// eigenvec の大きさが A と同じなら初期ベクトルとして使い, INVERSE_RAYLEIGH では最初からレイリー商をシフトにする
+// (与えなければ初期シフトでの反復が目的の固有ベクトルに十分近づいてから切り替える). verbose なら途中経過を表示する.
+// レイリー商のシフトで解けなければ最後に解けたシフトに戻し, それでも (A - σI) y = x が解けなければ警告を出して -1 を返す
+int inverse_power_method(const Matrix& A, double shift, double& eigenval, Vector& eigenvec,
+                         InverseIterationMode mode, int max_iterations = 100, double tolerance = 1e-12,
+                         bool verbose = false);
+
+// 積 matvec と連立方程式の解法 solve だけを使う逆反復法. anorm は収束判定に使う ||A|| で,
+// 0 以下なら数回のべき乗法で見積もる
+int inverse_power_method(const MatVec& matvec, const ShiftSolve& solve, int n, double shift, double& eigenval,
+                         Vector& eigenvec, InverseIterationMode mode, int max_iterations = 100,
+                         double tolerance = 1e-12, bool verbose = false, double anorm = 0.0);
+
+// 逆反復法の作業領域 (呼び出し側で使い回せば反復中のヒープ確保がなくなる)
+struct InverseWorkspace {
+    std::vector<double> x, y, Ax;
+};
+
+// 作業領域を使う逆反復法
+int inverse_power_method(const MatVec& matvec, const ShiftSolve& solve, int n, double shift, double& eigenval,
+                         Vector& eigenvec, InverseWorkspace& work, InverseIterationMode mode,
+                         int max_iterations = 100, double tolerance = 1e-12, bool verbose = false,
+                         double anorm = 0.0);
+
+// 複数のシフトに対する逆反復法. A を一度だけヘッセンベルグ化 (対称なら三重対角化) して各シフトの方程式を
+// O(n^2) (三重対角なら O(n)) で解き, pool を渡すとシフトをスレッドに分配する. 対称行列では近いシフトの
+// ベクトルを互いに直交化する. 固有値 (レイリー商) を eigenvalues に, 固有ベクトルを vectors の列に格納し,
+// シフトあたりの最大反復回数を返す
+int inverse_iteration_batch(const Matrix& A, const std::vector<double>& shifts, std::vector<double>& eigenvalues,
+                            Matrix& vectors, ThreadPool* pool = nullptr, int max_iterations = 10,
+                            double tolerance = 1e-12);
+
+// 行列積や行列ベクトル積などの並列化の設定
+// 共有スレッドプール (thread_pool.h) を num_threads スレッド (0 以下ならハードウェアのスレッド数) にし,
+// 演算量 (積和の回数) が min_work 未満の演算は呼んだスレッドだけで計算する (3x3 などの小さな行列用)
+void set_parallel_options(int num_threads, double min_work = 1 << 17);
+
+// フロベニウスノルム
+double matrix_norm(const Matrix& A);
+
+// 残差 ||A x - λ x|| (2ノルム)
+double residual_norm(const Matrix& A, const Vector& x, double lambda);
+
+// 行列積 C = A B (gemm.h のキャッシュブロッキングと SIMD のカーネルで計算する. C は A, B と別の行列)
+// 以下の行列演算は, 大きな行列では共有スレッドプールで並列に計算する
+void matrix_multiply(const Matrix& A, const Matrix& B, Matrix& C);
+
+// 行列ベクトル積 y = A x (y は x と別のベクトル)
+void matrix_vector_multiply(const Matrix& A, const Vector& x, Vector& y);
+
+// 転置 At = A^T (At は A と別の行列)
+void transpose(const Matrix& A, Matrix& At);
+
 // QR分解
 void qr_decomposition(Matrix& A, Matrix& Q, Matrix& R);
 
+// ハウスホルダー変換による上ヘッセンベルグ化 (A を上書き)
+// Q を渡すと A_元 = Q H Q^T となる直交行列を格納する. block_size > 1 なら大きな行列でブロック化する
+void hessenberg_reduction(Matrix& A, Matrix* Q = nullptr, int block_size = 32);
+
+// ヘッセンベルグ化の作業領域 (同じ大きさで使い回せばヒープ確保がない)
+struct HessenbergWork {
+    std::vector<double> V, Y, T, v, w, Vt, Vtr, W, TW, QV, QVT, buf, out, wv;
+};
+
+// 作業領域を使うヘッセンベルグ化
+void hessenberg_reduction(Matrix& A, HessenbergWork& work, Matrix* Q = nullptr, int block_size = 32);
+
 // Wilkinsonシフトの計算
 double wilkinson_shift(const Matrix& H, int n);
 
 // 2x2ブロックの固有値計算
 std::pair<std::complex<double>, std::complex<double>> eigenvalues_2x2(const Matrix& H, int i);
 
-// ダブルQR法による固有値計算
-std::vector<std::complex<double>> eigenvalues_double_qr(Matrix A, int max_iterations = 200, double tolerance = 1e-12);
+// QR法の反復戦略
+enum QRStrategy {
+    QR_FRANCIS,    // 末尾2x2ブロックをシフトとするFrancisダブルシフト (1反復に1バルジ)
+    QR_AED,        // 積極的早期収縮 (AED) と, 収縮できなかった固有値をシフトとする一括スイープ
+    QR_MULTISHIFT  // AED に加え, 一括シフトを小さなバルジの鎖として追跡し, 変換を行列積でまとめて適用
+};
+
+// ダブルQR法 (Francisのダブルシフト) による固有値計算
+// max_iterations は固有値1つあたりの反復上限. iteration_counts には各固有値の反復回数が入る
+std::vector<std::complex<double>> eigenvalues_double_qr(Matrix A, int max_iterations = 200, double tolerance = 1e-12,
+                                                        std::vector<int>* iteration_counts = nullptr,
+                                                        QRStrategy strategy = QR_FRANCIS);
+
+// 実Schur分解 A = Z T Z^T (A を準上三角行列 T で上書きし, Schurベクトルを Z に格納)
+// T の 2x2 ブロックは複素共役な固有値の対で, 対角要素が等しく副対角要素が異符号の標準形になる
+bool schur_decomposition(Matrix& A, Matrix& Z, int max_iterations = 200, double tolerance = 1e-12,
+                         QRStrategy strategy = QR_FRANCIS);
+
+// ダブルQR法による固有値と右固有ベクトルの計算
+// j 番目の固有値の固有ベクトルは vr の j 列 + i * (vi の j 列) (2ノルムで正規化)
+// QR反復が収束しなかった場合は警告を出して空の固有値を返し, vr, vi も空にする
+std::vector<std::complex<double>> eigenvectors_double_qr(Matrix A, Matrix& vr, Matrix& vi,
+                                                         int max_iterations = 200, double tolerance = 1e-12,
+                                                         QRStrategy strategy = QR_FRANCIS);
+
+// 対称行列の判定 (|A(i,j) - A(j,i)| が tolerance * ||A||_F 以下なら対称とみなす)
+bool is_symmetric(const Matrix& A, double tolerance = 1e-14);
+
+// ハウスホルダー変換による対称行列の三重対角化 (下三角部分のみを参照し, A は作業領域として上書きされる)
+// 対角要素を d[0..n-1], 副対角要素を e[0..n-2] に格納する. Qt を渡すと A = Qt^T T Qt となる Qt を格納する
+void tridiagonal_reduction(Matrix& A, std::vector<double>& d, std::vector<double>& e, Matrix* Qt = nullptr);
+
+// 対称三重対角行列の陰的シフト付きQR法 (Wilkinsonシフト)
+// d に固有値を昇順で格納する. Zt を渡すと各行に回転を累積し, 固有値の順に並べ替える
+// max_iterations は固有値1つあたりの反復上限. 収束しなかった場合は false を返す
+bool tridiagonal_qr(std::vector<double>& d, std::vector<double>& e, Matrix* Zt = nullptr, int max_iterations = 30);
+
+// 対称行列の固有値 (昇順) と, eigenvectors を渡せば対応する固有ベクトル (列) の計算
+std::vector<double> eigenvalues_symmetric(Matrix A, Matrix* eigenvectors = nullptr, int max_iterations = 30);
+
+// 部分空間反復 (Rayleigh-Ritz と収束したベクトルの固定付き) による絶対値の大きい k 個の固有値
+// 絶対値の降順に eigenvalues に格納し (k 番目が複素共役対をまたぐときは k+1 個), vectors を渡すと
+// 対応する Schurベクトル (対称行列なら固有ベクトル) を列に格納する. 反復回数を返す
+int subspace_iteration(const Matrix& A, int k, std::vector<std::complex<double>>& eigenvalues,
+                       Matrix* vectors = nullptr, int max_iterations = 1000, double tolerance = 1e-10);
+
+// 行列ベクトル積 matvec だけを使う部分空間反復 (n は次元, symmetric なら対称行列として扱う)
+int subspace_iteration(const MatVec& matvec, int n, bool symmetric, int k,
+                       std::vector<std::complex<double>>& eigenvalues, Matrix* vectors = nullptr,
+                       int max_iterations = 1000, double tolerance = 1e-10);
+
+// Krylov 部分空間法の実行結果
+struct KrylovInfo {
+    int restarts;             // 再出発の回数
+    int matvecs;              // 行列ベクトル積の回数
+    size_t workspace_bytes;   // 作業領域の大きさ [バイト] (n と Krylov 基底の本数の積に比例)
+};
+
+// 陰的再出発 Lanczos 法 (symmetric = true) / Arnoldi 法による絶対値の大きい k 個の固有値
+// 行列は matvec でのみ参照する. 固有値は絶対値の降順 (k 番目が複素共役対をまたぐときは k+1 個) で,
+// vr, vi を渡すと Ritz ベクトルの実部と虚部を列に格納する. 再出発の回数を返す
+// (射影した行列のQRが収束しなかった場合は固有値を空にして -1 を返す)
+int krylov_eigenvalues(const MatVec& matvec, int n, int k, bool symmetric,
+                       std::vector<std::complex<double>>& eigenvalues,
+                       Matrix* vr = nullptr, Matrix* vi = nullptr, KrylovInfo* info = nullptr,
+                       int max_restarts = 300, double tolerance = 1e-10);
+
+// 統合インターフェースの計算方法
+enum EigenMethod {
+    EIG_QR,         // QR法 (対称行列なら三重対角化の経路に自動で切り替える)
+    EIG_SYMMETRIC,  // 常に対称として三重対角化と対称QR法
+    EIG_POWER,      // べき乗法 (最大固有値のみ)
+    EIG_INVERSE,    // 逆べき乗法 (shift に最も近い固有値)
+    EIG_RAYLEIGH,   // shift を初期値とするレイリー商反復で近くの固有値を1つ
+    EIG_SUBSPACE,   // 部分空間反復 (絶対値の大きい k 個)
+    EIG_LANCZOS,    // 陰的再出発 Lanczos 法 (対称, 絶対値の大きい k 個)
+    EIG_ARNOLDI     // 陰的再出発 Arnoldi 法 (絶対値の大きい k 個)
+};
+
+// "qr", "symmetric", "power", "inverse", "rayleigh", "subspace", "lanczos", "arnoldi" を EigenMethod に直す.
+// 未知の名前なら false を返す
+bool parse_eigen_method(const std::string& name, EigenMethod& method);
+
+// 統合インターフェース (文字列の比較も結果の std::vector の確保もしない版)
+// 固有値の実部を re, 虚部を im に書き, 個数を返す. im が nullptr なら虚部は書かない.
+// EIG_POWER が収束しなかったとき, EIG_INVERSE, EIG_RAYLEIGH で連立方程式が解けなかったときは何も書かずに -1 を返す
+// (文字列版は空の配列を返す).
+// re, im には A.row() 個 (EIG_SUBSPACE, EIG_LANCZOS, EIG_ARNOLDI では k 番目が複素共役対をまたぐことがあるので k + 1 個) 以上の領域を渡す
+// (4x4 以下の行列は EIG_QR, EIG_SYMMETRIC とも固定サイズの SmallMatrix (small_matrix.h) に写して解く)
+int compute_eigenvalues(const Matrix& A, EigenMethod method, double* re, double* im, double shift = 0.0, int k = 1);
+
+// 統合インターフェース (互換のための文字列版. method の名前は parse_eigen_method を参照)
+std::vector<std::complex<double>> compute_eigenvalues(const Matrix& A, const std::string& method = "qr", double shift = 0.0,
+                                                      int k = 1);
+
+// 同じ大きさの問題を繰り返し解くための文脈. 作業領域を持ち回り, 逆反復法の (A - σI) の LU 分解を
+// 直前の行列とシフトについて覚えておく. 同じ大きさで2回目以降に呼べばヒープ確保はない
+// (行列の中身は毎回前回の写しと比べるので, 呼び出し側で A を書き換えてもよい.
+//  QR_AED, QR_MULTISHIFT では AED の窓の作業領域を反復ごとに確保する)
+class EigenSolver {
+public:
+    EigenSolver();
+
+    // シフトを選べる逆反復法 (引数と戻り値は inverse_power_method と同じで, 解けなければ -1)
+    int inverse_power_method(const Matrix& A, double shift, double& eigenval, Vector& eigenvec,
+                             InverseIterationMode mode = INVERSE_FIXED_SHIFT, int max_iterations = 100,
+                             double tolerance = 1e-12, bool verbose = false);
+
+    // ダブルQR法 (引数は eigenvalues_double_qr と同じ). 結果は次の呼び出しまで有効な内部の配列
+    const std::vector<std::complex<double>>& eigenvalues_double_qr(const Matrix& A, int max_iterations = 200,
+                                                                   double tolerance = 1e-12,
+                                                                   QRStrategy strategy = QR_FRANCIS);
+
+    // これまでに行った LU 分解の回数
+    long factorizations() const { return factorizations_; }
+
+private:
+    bool load(const Matrix& A);
+    bool shift_solve(double sigma, const double* b, double* x);
+
+    int n_;
+    Matrix A_, lu_, H_;              // 直前の行列の写し, (A - σI) の LU 分解, QR法で上書きする行列
+    std::vector<int> pivot_;
+    Vector rhs_;                     // LUslv に渡す右辺と解
+    double anorm_;                   // 直前の行列の ||A||_F
+    double factored_shift_;
+    bool factored_;
+    long factorizations_;
+    InverseWorkspace inverse_work_;
+    HessenbergWork hessenberg_work_;
+    std::vector<std::complex<double>> eigenvalues_;
+};
+
+// 線形作用素 (linear_operator.h) を受け取る反復法
+// 作用素は size() と apply() を持てばよく, inverse_power_method には shift_solve() も必要
+template <class Op>
+int power_method(const Op& A, double& eigenval, Vector& eigenvec, PowerWorkspace& work,
+                 int max_iterations = 100, double tolerance = 1e-10, bool verbose = false) {
+    return power_method(make_matvec(A), A.size(), eigenval, eigenvec, work, max_iterations, tolerance, verbose);
+}
+
+template <class Op>
+int inverse_power_method(const Op& A, double shift, double& eigenval, Vector& eigenvec, InverseIterationMode mode,
+                         int max_iterations = 100, double tolerance = 1e-12, bool verbose = false) {
+    return inverse_power_method(make_matvec(A), make_shift_solve(A), A.size(), shift, eigenval, eigenvec, mode,
+                                max_iterations, tolerance, verbose);
+}
+
+template <class Op>
+int subspace_iteration(const Op& A, bool symmetric, int k, std::vector<std::complex<double>>& eigenvalues,
+                       Matrix* vectors = nullptr, int max_iterations = 1000, double tolerance = 1e-10) {
+    return subspace_iteration(make_matvec(A), A.size(), symmetric, k, eigenvalues, vectors, max_iterations,
+                              tolerance);
+}
 
-// 統合インターフェース
-std::vector<std::complex<double>> compute_eigenvalues(const Matrix& A, const std::string& method = "qr", double shift = 0.0);
+template <class Op>
+int krylov_eigenvalues(const Op& A, int k, bool symmetric, std::vector<std::complex<double>>& eigenvalues,
+                       Matrix* vr = nullptr, Matrix* vi = nullptr, KrylovInfo* info = nullptr,
+                       int max_restarts = 300, double tolerance = 1e-10) {
+    return krylov_eigenvalues(make_matvec(A), A.size(), k, symmetric, eigenvalues, vr, vi, info, max_restarts,
+                              tolerance);
+}
 
 #endif // _eigenvalue_methods_h
\ No newline at end of file
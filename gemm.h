@@ -0,0 +1,268 @@
+#ifndef _gemm_h
+#define _gemm_h
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define GEMM_X86 1
+#include <immintrin.h>
+#endif
+
+// 密行列積 C = A B (accumulate なら C += A B)
+// A は m x k, B は k x n, C は m x n で, いずれも0始まり行優先, 行の間隔が lda, ldb, ldc の配列
+//
+// B を kc x nc のブロック, A を mc x kc のブロックに分けて連続領域に詰め直し (パッキング),
+// 詰めた A の mr 行と B の nr 列から C の mr x nr のタイルをレジスタ上で積和するマイクロカーネルで計算する.
+// 詰めた B のブロックは L3 / L2, A のブロックは L2, 1本の A, B のパネルは L1 に収まる大きさにしている.
+// マイクロカーネルは実行時に CPU を調べて AVX-512, AVX2 + FMA, スカラーの順に選ぶ
+
+// マイクロカーネルの種類
+enum GemmKernel {
+    GEMM_SCALAR,   // 4 x 8 (SIMD 命令を直接は使わない)
+    GEMM_AVX2,     // 6 x 8 (AVX2 + FMA)
+    GEMM_AVX512    // 8 x 16 (AVX-512F)
+};
+
+namespace gemm_params {
+    const int kc = 256;    // 積和の長さ方向のブロック
+    const int mc = 96;     // A のブロックの行数 (各カーネルの mr の倍数)
+    const int nc = 2048;   // B のブロックの列数 (各カーネルの nr の倍数)
+}
+
+// マイクロカーネル: c(mr x nr, 行の間隔 ldc) = (add ? c : 0) + a b
+// a は kc 段の mr 個ずつ (a[p*mr + r]), b は kc 段の nr 個ずつ (b[p*nr + j]) に詰めたもの
+inline void gemm_micro_scalar(int kc, const double* a, const double* b, double* c, int ldc, bool add) {
+    const int MR = 4, NR = 8;
+    double acc[MR][NR] = {};
+    for (int p = 0; p < kc; ++p) {
+        for (int r = 0; r < MR; ++r) {
+            double ar = a[p * MR + r];
+            for (int j = 0; j < NR; ++j) acc[r][j] += ar * b[p * NR + j];
+        }
+    }
+    for (int r = 0; r < MR; ++r) {
+        double* cr = c + (size_t)r * ldc;
+        for (int j = 0; j < NR; ++j) cr[j] = add ? cr[j] + acc[r][j] : acc[r][j];
+    }
+}
+
+#ifdef GEMM_X86
+__attribute__((target("avx2,fma")))
+inline void gemm_micro_avx2(int kc, const double* a, const double* b, double* c, int ldc, bool add) {
+    __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+    __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+    __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+    __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+    __m256d c40 = _mm256_setzero_pd(), c41 = _mm256_setzero_pd();
+    __m256d c50 = _mm256_setzero_pd(), c51 = _mm256_setzero_pd();
+    for (int p = 0; p < kc; ++p) {
+        __m256d b0 = _mm256_loadu_pd(b), b1 = _mm256_loadu_pd(b + 4);
+        __m256d x;
+        x = _mm256_broadcast_sd(a + 0); c00 = _mm256_fmadd_pd(x, b0, c00); c01 = _mm256_fmadd_pd(x, b1, c01);
+        x = _mm256_broadcast_sd(a + 1); c10 = _mm256_fmadd_pd(x, b0, c10); c11 = _mm256_fmadd_pd(x, b1, c11);
+        x = _mm256_broadcast_sd(a + 2); c20 = _mm256_fmadd_pd(x, b0, c20); c21 = _mm256_fmadd_pd(x, b1, c21);
+        x = _mm256_broadcast_sd(a + 3); c30 = _mm256_fmadd_pd(x, b0, c30); c31 = _mm256_fmadd_pd(x, b1, c31);
+        x = _mm256_broadcast_sd(a + 4); c40 = _mm256_fmadd_pd(x, b0, c40); c41 = _mm256_fmadd_pd(x, b1, c41);
+        x = _mm256_broadcast_sd(a + 5); c50 = _mm256_fmadd_pd(x, b0, c50); c51 = _mm256_fmadd_pd(x, b1, c51);
+        a += 6;
+        b += 8;
+    }
+    __m256d acc[6][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}};
+    for (int r = 0; r < 6; ++r) {
+        double* cr = c + (size_t)r * ldc;
+        if (add) {
+            acc[r][0] = _mm256_add_pd(acc[r][0], _mm256_loadu_pd(cr));
+            acc[r][1] = _mm256_add_pd(acc[r][1], _mm256_loadu_pd(cr + 4));
+        }
+        _mm256_storeu_pd(cr, acc[r][0]);
+        _mm256_storeu_pd(cr + 4, acc[r][1]);
+    }
+}
+
+__attribute__((target("avx512f")))
+inline void gemm_micro_avx512(int kc, const double* a, const double* b, double* c, int ldc, bool add) {
+    __m512d c00 = _mm512_setzero_pd(), c01 = _mm512_setzero_pd();
+    __m512d c10 = _mm512_setzero_pd(), c11 = _mm512_setzero_pd();
+    __m512d c20 = _mm512_setzero_pd(), c21 = _mm512_setzero_pd();
+    __m512d c30 = _mm512_setzero_pd(), c31 = _mm512_setzero_pd();
+    __m512d c40 = _mm512_setzero_pd(), c41 = _mm512_setzero_pd();
+    __m512d c50 = _mm512_setzero_pd(), c51 = _mm512_setzero_pd();
+    __m512d c60 = _mm512_setzero_pd(), c61 = _mm512_setzero_pd();
+    __m512d c70 = _mm512_setzero_pd(), c71 = _mm512_setzero_pd();
+    for (int p = 0; p < kc; ++p) {
+        __m512d b0 = _mm512_loadu_pd(b), b1 = _mm512_loadu_pd(b + 8);
+        __m512d x;
+        x = _mm512_set1_pd(a[0]); c00 = _mm512_fmadd_pd(x, b0, c00); c01 = _mm512_fmadd_pd(x, b1, c01);
+        x = _mm512_set1_pd(a[1]); c10 = _mm512_fmadd_pd(x, b0, c10); c11 = _mm512_fmadd_pd(x, b1, c11);
+        x = _mm512_set1_pd(a[2]); c20 = _mm512_fmadd_pd(x, b0, c20); c21 = _mm512_fmadd_pd(x, b1, c21);
+        x = _mm512_set1_pd(a[3]); c30 = _mm512_fmadd_pd(x, b0, c30); c31 = _mm512_fmadd_pd(x, b1, c31);
+        x = _mm512_set1_pd(a[4]); c40 = _mm512_fmadd_pd(x, b0, c40); c41 = _mm512_fmadd_pd(x, b1, c41);
+        x = _mm512_set1_pd(a[5]); c50 = _mm512_fmadd_pd(x, b0, c50); c51 = _mm512_fmadd_pd(x, b1, c51);
+        x = _mm512_set1_pd(a[6]); c60 = _mm512_fmadd_pd(x, b0, c60); c61 = _mm512_fmadd_pd(x, b1, c61);
+        x = _mm512_set1_pd(a[7]); c70 = _mm512_fmadd_pd(x, b0, c70); c71 = _mm512_fmadd_pd(x, b1, c71);
+        a += 8;
+        b += 16;
+    }
+    __m512d acc[8][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31},
+                         {c40, c41}, {c50, c51}, {c60, c61}, {c70, c71}};
+    for (int r = 0; r < 8; ++r) {
+        double* cr = c + (size_t)r * ldc;
+        if (add) {
+            acc[r][0] = _mm512_add_pd(acc[r][0], _mm512_loadu_pd(cr));
+            acc[r][1] = _mm512_add_pd(acc[r][1], _mm512_loadu_pd(cr + 8));
+        }
+        _mm512_storeu_pd(cr, acc[r][0]);
+        _mm512_storeu_pd(cr + 8, acc[r][1]);
+    }
+}
+#endif
+
+// この CPU で使える最も速いカーネル (最初の呼び出しで一度だけ調べる)
+inline GemmKernel gemm_best_kernel() {
+#ifdef GEMM_X86
+    static const GemmKernel best = __builtin_cpu_supports("avx512f") ? GEMM_AVX512
+        : (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) ? GEMM_AVX2 : GEMM_SCALAR;
+    return best;
+#else
+    return GEMM_SCALAR;
+#endif
+}
+
+// カーネルがこの CPU で使えるか
+inline bool gemm_kernel_available(GemmKernel kernel) {
+    return kernel <= gemm_best_kernel();
+}
+
+inline const char* gemm_kernel_name(GemmKernel kernel) {
+    switch (kernel) {
+        case GEMM_AVX512: return "AVX-512";
+        case GEMM_AVX2: return "AVX2";
+        default: return "Scalar";
+    }
+}
+
+// 転置した因子も扱える gemm: C = op(A) op(B) (accumulate なら C += op(A) op(B))
+// trans_a なら op(A) = A^T で A は k x m の配列, trans_b なら op(B) = B^T で B は n x k の配列.
+// 転置はパッキングのときに読む順序を変えるだけなので, 転置した行列を作る必要はない.
+// kernel がこの CPU で使えなければスカラーのカーネルにする
+inline void gemm(bool trans_a, bool trans_b, int m, int n, int k, const double* A, int lda,
+                 const double* B, int ldb, double* C, int ldc, bool accumulate, GemmKernel kernel) {
+    if (m <= 0 || n <= 0) return;
+    if (k <= 0) {
+        if (!accumulate) {
+            for (int i = 0; i < m; ++i) std::fill(C + (size_t)i * ldc, C + (size_t)i * ldc + n, 0.0);
+        }
+        return;
+    }
+    if (!gemm_kernel_available(kernel)) kernel = GEMM_SCALAR;
+
+    int MR = 4, NR = 8;
+    void (*micro)(int, const double*, const double*, double*, int, bool) = gemm_micro_scalar;
+#ifdef GEMM_X86
+    if (kernel == GEMM_AVX2) {
+        MR = 6;
+        micro = gemm_micro_avx2;
+    } else if (kernel == GEMM_AVX512) {
+        MR = 8;
+        NR = 16;
+        micro = gemm_micro_avx512;
+    }
+#endif
+
+    // パッキング用の領域はスレッドごとに使い回す (端のタイルは tile に計算してから足す)
+    static thread_local std::vector<double> packed_a, packed_b;
+    const int KC = gemm_params::kc, MC = gemm_params::mc, NC = gemm_params::nc;
+    packed_a.resize((size_t)MC * KC);
+    packed_b.resize((size_t)KC * (std::min(NC, n) + NR));
+    double tile[8 * 16];
+
+    for (int jc = 0; jc < n; jc += NC) {
+        int nc = std::min(NC, n - jc);
+        for (int pc = 0; pc < k; pc += KC) {
+            int kc = std::min(KC, k - pc);
+            bool add = accumulate || pc > 0;
+
+            // B(pc.., jc..) を nr 列ずつのパネルに詰める (端は0で埋める)
+            for (int jr = 0; jr < nc; jr += NR) {
+                int nr = std::min(NR, nc - jr);
+                double* bp = &packed_b[(size_t)jr * kc];
+                if (!trans_b) {
+                    for (int p = 0; p < kc; ++p) {
+                        const double* brow = B + (size_t)(pc + p) * ldb + jc + jr;
+                        int j = 0;
+                        for (; j < nr; ++j) bp[j] = brow[j];
+                        for (; j < NR; ++j) bp[j] = 0.0;
+                        bp += NR;
+                    }
+                } else {
+                    for (int j = 0; j < nr; ++j) {
+                        const double* bcol = B + (size_t)(jc + jr + j) * ldb + pc;
+                        for (int p = 0; p < kc; ++p) bp[p * NR + j] = bcol[p];
+                    }
+                    for (int j = nr; j < NR; ++j) {
+                        for (int p = 0; p < kc; ++p) bp[p * NR + j] = 0.0;
+                    }
+                }
+            }
+
+            for (int ic = 0; ic < m; ic += MC) {
+                int mc = std::min(MC, m - ic);
+
+                // A(ic.., pc..) を mr 行ずつのパネルに詰める
+                for (int ir = 0; ir < mc; ir += MR) {
+                    int mr = std::min(MR, mc - ir);
+                    double* ap = &packed_a[(size_t)ir * kc];
+                    if (!trans_a) {
+                        for (int r = 0; r < mr; ++r) {
+                            const double* arow = A + (size_t)(ic + ir + r) * lda + pc;
+                            for (int p = 0; p < kc; ++p) ap[p * MR + r] = arow[p];
+                        }
+                    } else {
+                        for (int p = 0; p < kc; ++p) {
+                            const double* acol = A + (size_t)(pc + p) * lda + ic + ir;
+                            for (int r = 0; r < mr; ++r) ap[p * MR + r] = acol[r];
+                        }
+                    }
+                    for (int r = mr; r < MR; ++r) {
+                        for (int p = 0; p < kc; ++p) ap[p * MR + r] = 0.0;
+                    }
+                }
+
+                for (int jr = 0; jr < nc; jr += NR) {
+                    int nr = std::min(NR, nc - jr);
+                    const double* bp = &packed_b[(size_t)jr * kc];
+                    for (int ir = 0; ir < mc; ir += MR) {
+                        int mr = std::min(MR, mc - ir);
+                        const double* ap = &packed_a[(size_t)ir * kc];
+                        double* c = C + (size_t)(ic + ir) * ldc + jc + jr;
+                        if (mr == MR && nr == NR) {
+                            micro(kc, ap, bp, c, ldc, add);
+                        } else {
+                            micro(kc, ap, bp, tile, NR, false);
+                            for (int r = 0; r < mr; ++r) {
+                                double* cr = c + (size_t)r * ldc;
+                                for (int j = 0; j < nr; ++j) cr[j] = add ? cr[j] + tile[r * NR + j] : tile[r * NR + j];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// 使うカーネルを指定する gemm
+inline void gemm(int m, int n, int k, const double* A, int lda, const double* B, int ldb,
+                 double* C, int ldc, bool accumulate, GemmKernel kernel) {
+    gemm(false, false, m, n, k, A, lda, B, ldb, C, ldc, accumulate, kernel);
+}
+
+// 最も速いカーネルでの gemm
+inline void gemm(int m, int n, int k, const double* A, int lda, const double* B, int ldb,
+                 double* C, int ldc, bool accumulate = false) {
+    gemm(false, false, m, n, k, A, lda, B, ldb, C, ldc, accumulate, gemm_best_kernel());
+}
+
+#endif // _gemm_h
@@ -30,6 +30,25 @@ int main() {
     vector<complex<double>> inverse_eigenvals = compute_eigenvalues(A, "inverse", 2.0);
     cout << inverse_eigenvals[0].real() << endl;
     
+    cout << "\n   同じシフトからのレイリー商反復:" << endl;
+    double rqi_eigenval;
+    Vector fixed_eigenvec, rqi_eigenvec;
+    int fixed_iterations = inverse_power_method(A, 2.0, rqi_eigenval, fixed_eigenvec, INVERSE_FIXED_SHIFT);
+    int rqi_iterations = inverse_power_method(A, 2.0, rqi_eigenval, rqi_eigenvec, INVERSE_RAYLEIGH);
+    cout << rqi_eigenval << " (固定シフト " << fixed_iterations << "回, レイリー商反復 " << rqi_iterations << "回)" << endl;
+    
+    cout << "\n4. 部分空間反復による絶対値の大きい2個の固有値:" << endl;
+    vector<complex<double>> subspace_eigenvals = compute_eigenvalues(A, "subspace", 0.0, 2);
+    for(const auto& val : subspace_eigenvals) {
+        cout << val.real() << endl;
+    }
+    
+    cout << "\n5. Lanczos法による絶対値の大きい2個の固有値:" << endl;
+    vector<complex<double>> lanczos_eigenvals = compute_eigenvalues(A, "lanczos", 0.0, 2);
+    for(const auto& val : lanczos_eigenvals) {
+        cout << val.real() << endl;
+    }
+    
     cout << "\nテストケース2: 複素固有値を持つ非対称行列" << endl;
     Matrix B(3,3);
     B = 1.0, -1.0, 2.0,
@@ -37,14 +56,36 @@ int main() {
         1.0,  1.0, 2.0;
     
     cout << "行列 B:" << endl << B << endl;
-    vector<complex<double>> eigenvals_B = compute_eigenvalues(B, "qr");
-    cout << "固有値:" << endl;
-    for(const auto& val : eigenvals_B) {
+    vector<int> iterations_B;
+    vector<complex<double>> eigenvals_B = eigenvalues_double_qr(B, 200, 1e-12, &iterations_B);
+    cout << "固有値 (反復回数):" << endl;
+    for(size_t i = 0; i < eigenvals_B.size(); i++) {
+        const complex<double>& val = eigenvals_B[i];
         if(abs(val.imag()) < 1e-10) {
-            cout << val.real() << endl;
+            cout << val.real();
         } else {
-            cout << val.real() << " + " << val.imag() << "i" << endl;
+            cout << val.real() << " + " << val.imag() << "i";
+        }
+        cout << " (" << iterations_B[i] << "回)" << endl;
+    }
+    
+    // Schur分解から全ての固有ベクトルを後退代入で求める
+    Matrix vr_B, vi_B;
+    vector<complex<double>> schur_eigenvals_B = eigenvectors_double_qr(B, vr_B, vi_B);
+    cout << "固有ベクトル:" << endl;
+    for(size_t k = 1; k <= schur_eigenvals_B.size(); k++) {
+        const complex<double>& val = schur_eigenvals_B[k-1];
+        cout << "λ = " << val.real();
+        if(abs(val.imag()) >= 1e-10) cout << " + " << val.imag() << "i";
+        cout << ":";
+        for(int i = 1; i <= B.row(); i++) {
+            if(abs(vi_B(i, k)) < 1e-10) {
+                cout << " " << vr_B(i, k);
+            } else {
+                cout << " (" << vr_B(i, k) << " + " << vi_B(i, k) << "i)";
+            }
         }
+        cout << endl;
     }
     
     cout << "\nテストケース3: 純虚数固有値を持つ行列" << endl;
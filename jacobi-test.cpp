@@ -1,62 +1,222 @@
 #include "pch.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <chrono>
 using namespace std;
 
 // 計算パラメータ
 namespace params {
-    const double eps = 1e-10;  // 収束判定値
+    const double eps = 1e-10;     // 収束判定値
+    const int max_sweeps = 50;    // 最大スイープ回数
+    const int bench_size = 500;   // 計算時間を測る行列のサイズ
+    const int bench_threads[] = {1, 2, 4, 8, 16, 32, 64};  // 並列版を測るスレッド数
 }
 
+// 巡回ヤコビ法
+// 上三角の (p, q) を行ごとに巡回し, 回転で A(p,q) を消去する. 回転は p, q 行と列だけを
+// その場で更新する O(n) の操作で, 回転角は tan を直接求める安定な式で計算する.
+// 最初の3スイープは小さな要素を飛ばす閾値を使い, 収束後の A の対角要素が固有値になる
 void jacobi_method(Matrix& A, Vector& eigenvals, Matrix& eigenvecs) {
     int n = A.row();
     eigenvecs.resize(n, n);
     eigenvals.resize(n);
     
-    // 初期化：固有ベクトル行列を単位行列に
-    for(int i = 1; i <= n; i++) {
-        for(int j = 1; j <= n; j++) {
-            eigenvecs(i,j) = (i == j) ? 1.0 : 0.0;
-        }
-    }
+    // 固有ベクトルは転置した形 (行) で累積し, 回転を連続した行の更新にする
+    Matrix Vt(n, n);
+    for(int i = 1; i <= n; i++) Vt(i,i) = 1.0;
     
-    while(true) {
-        // 最大非対角要素の探索
-        double max_val = 0.0;
-        int p = 1, q = 1;
+    int sweep;
+    for(sweep = 1; sweep <= params::max_sweeps; sweep++) {
+        // 非対角要素の最大値と絶対値和
+        double max_val = 0.0, off_sum = 0.0;
         for(int i = 1; i <= n; i++) {
             for(int j = i+1; j <= n; j++) {
-                if(abs(A(i,j)) > max_val) {
-                    max_val = abs(A(i,j));
-                    p = i;
-                    q = j;
-                }
+                max_val = max(max_val, abs(A(i,j)));
+                off_sum += abs(A(i,j));
             }
         }
-        
         if(max_val < params::eps) break;  // 収束判定
         
-        // 回転角の計算
-        double theta;
-        if(abs(A(p,p) - A(q,q)) < params::eps) {
-            theta = pi/4.0;
-        } else {
-            theta = 0.5 * atan(2.0 * A(p,q) / (A(p,p) - A(q,q)));
+        double threshold = (sweep <= 3) ? 0.2 * off_sum / (n * n) : 0.0;
+        
+        for(int p = 1; p <= n; p++) {
+            for(int q = p+1; q <= n; q++) {
+                double apq = A(p,q);
+                double g = 100.0 * abs(apq);
+                
+                // 対角要素に比べて無視できる要素は回転せずに0とする
+                if(sweep > 4 && abs(A(p,p)) + g == abs(A(p,p)) && abs(A(q,q)) + g == abs(A(q,q))) {
+                    A(p,q) = A(q,p) = 0.0;
+                    continue;
+                }
+                if(abs(apq) <= threshold || apq == 0.0) continue;
+                
+                // t = tanθ (|θ| <= π/4 となる小さい方の根)
+                double h = A(q,q) - A(p,p);
+                double t;
+                if(abs(h) + g == abs(h)) {
+                    t = apq / h;
+                } else {
+                    double theta = 0.5 * h / apq;
+                    t = 1.0 / (abs(theta) + sqrt(1.0 + theta * theta));
+                    if(theta < 0.0) t = -t;
+                }
+                double c = 1.0 / sqrt(1.0 + t * t);
+                double s = t * c;
+                double tau = s / (1.0 + c);
+                
+                double app = A(p,p) - t * apq;
+                double aqq = A(q,q) + t * apq;
+                
+                // p, q 行を連続アクセスで更新し, 対称性から p, q 列に書き写す
+                for(int j = 1; j <= n; j++) {
+                    double ap = A(p,j), aq = A(q,j);
+                    A(p,j) = ap - s * (aq + tau * ap);
+                    A(q,j) = aq + s * (ap - tau * aq);
+                }
+                A(p,p) = app;
+                A(q,q) = aqq;
+                A(p,q) = A(q,p) = 0.0;
+                for(int j = 1; j <= n; j++) {
+                    A(j,p) = A(p,j);
+                    A(j,q) = A(q,j);
+                }
+                for(int j = 1; j <= n; j++) {
+                    double vp = Vt(p,j), vq = Vt(q,j);
+                    Vt(p,j) = vp - s * (vq + tau * vp);
+                    Vt(q,j) = vq + s * (vp - tau * vq);
+                }
+            }
         }
+    }
+    
+    if(sweep > params::max_sweeps) {
+        cout << "警告: 最大反復回数に達しました" << endl;
+    } else {
+        cout << "収束しました(" << sweep - 1 << "回のスイープ)" << endl;
+    }
+    
+    // 固有値と固有ベクトル (列) を取り出し
+    for(int i = 1; i <= n; i++) {
+        eigenvals(i) = A(i,i);
+        for(int j = 1; j <= n; j++) eigenvecs(i,j) = Vt(j,i);
+    }
+}
+
+// 並列ヤコビ法 (総当たり戦の順序)
+// 1スイープを n-1 ラウンドに分け, 各ラウンドでは互いに重ならない n/2 組の (p, q) を
+// 同時に回転する. 回転 J をまとめて A <- J^T A J とするため, 各組の p, q 行の更新と
+// 各行の p, q 列の更新の2段階に分け, それぞれをスレッドプールで並列に実行する
+void jacobi_method_parallel(Matrix& A, Vector& eigenvals, Matrix& eigenvecs, ThreadPool& pool) {
+    int n = A.row();
+    eigenvecs.resize(n, n);
+    eigenvals.resize(n);
+    
+    Matrix Vt(n, n);
+    for(int i = 1; i <= n; i++) Vt(i,i) = 1.0;
+    
+    // 総当たり戦の対戦表. n が奇数なら番号 n+1 の休みを加える
+    int m = n + n % 2;
+    vector<int> order(m);
+    for(int i = 0; i < m; i++) order[i] = i + 1;
+    vector<int> P(m / 2), Q(m / 2);
+    vector<double> C(m / 2), S(m / 2);
+    
+    int sweep;
+    for(sweep = 1; sweep <= params::max_sweeps; sweep++) {
+        double max_val = 0.0, off_sum = 0.0;
+        for(int i = 1; i <= n; i++) {
+            for(int j = i+1; j <= n; j++) {
+                max_val = max(max_val, abs(A(i,j)));
+                off_sum += abs(A(i,j));
+            }
+        }
+        if(max_val < params::eps) break;  // 収束判定
         
-        // 回転行列による相似変換
-        Matrix R(n,n);
-        for(int i = 1; i <= n; i++) R(i,i) = 1.0;
-        R(p,p) = cos(theta);
-        R(p,q) = -sin(theta);
-        R(q,p) = sin(theta);
-        R(q,q) = cos(theta);
+        double threshold = (sweep <= 3) ? 0.2 * off_sum / (n * n) : 0.0;
         
-        A = trans(R) * A * R;
-        eigenvecs = eigenvecs * R;
+        for(int round = 0; round < m - 1; round++) {
+            int npairs = 0;
+            for(int k = 0; k < m / 2; k++) {
+                int p = min(order[k], order[m-1-k]);
+                int q = max(order[k], order[m-1-k]);
+                if(q > n) continue;
+                P[npairs] = p;
+                Q[npairs] = q;
+                npairs++;
+            }
+            
+            // 各組の回転を求め, p, q 行 (A と V^T) を更新する
+            pool.parallel_for(0, npairs, [&](int lo, int hi) {
+                for(int k = lo; k < hi; k++) {
+                    int p = P[k], q = Q[k];
+                    double apq = A(p,q);
+                    double g = 100.0 * abs(apq);
+                    S[k] = 0.0;
+                    if(sweep > 4 && abs(A(p,p)) + g == abs(A(p,p)) && abs(A(q,q)) + g == abs(A(q,q))) {
+                        A(p,q) = A(q,p) = 0.0;
+                        continue;
+                    }
+                    if(abs(apq) <= threshold || apq == 0.0) continue;
+                    
+                    double h = A(q,q) - A(p,p);
+                    double t;
+                    if(abs(h) + g == abs(h)) {
+                        t = apq / h;
+                    } else {
+                        double theta = 0.5 * h / apq;
+                        t = 1.0 / (abs(theta) + sqrt(1.0 + theta * theta));
+                        if(theta < 0.0) t = -t;
+                    }
+                    double c = 1.0 / sqrt(1.0 + t * t);
+                    double s = t * c;
+                    C[k] = c;
+                    S[k] = s;
+                    
+                    for(int j = 1; j <= n; j++) {
+                        double ap = A(p,j), aq = A(q,j);
+                        A(p,j) = c * ap - s * aq;
+                        A(q,j) = s * ap + c * aq;
+                    }
+                    for(int j = 1; j <= n; j++) {
+                        double vp = Vt(p,j), vq = Vt(q,j);
+                        Vt(p,j) = c * vp - s * vq;
+                        Vt(q,j) = s * vp + c * vq;
+                    }
+                }
+            });
+            
+            // 各行の p, q 列を更新する
+            pool.parallel_for(1, n + 1, [&](int lo, int hi) {
+                for(int i = lo; i < hi; i++) {
+                    for(int k = 0; k < npairs; k++) {
+                        double s = S[k];
+                        if(s == 0.0) continue;
+                        int p = P[k], q = Q[k];
+                        double c = C[k];
+                        double ap = A(i,p), aq = A(i,q);
+                        A(i,p) = c * ap - s * aq;
+                        A(i,q) = s * ap + c * aq;
+                    }
+                }
+            });
+            
+            for(int k = 0; k < npairs; k++) {
+                if(S[k] != 0.0) A(P[k],Q[k]) = A(Q[k],P[k]) = 0.0;
+            }
+            
+            // order[0] を固定して残りを1つずつずらす
+            rotate(order.begin() + 1, order.end() - 1, order.end());
+        }
+    }
+    
+    if(sweep > params::max_sweeps) {
+        cout << "警告: 最大反復回数に達しました" << endl;
     }
     
-    // 固有値を取り出し
     for(int i = 1; i <= n; i++) {
         eigenvals(i) = A(i,i);
+        for(int j = 1; j <= n; j++) eigenvecs(i,j) = Vt(j,i);
     }
 }
 
@@ -74,7 +234,8 @@ int main() {
     cout << "ヤコビ法による固有値・固有ベクトルの計算：" << endl;
     cout << "入力行列 A:" << endl << A << endl;
     
-    // ヤコビ法による計算
+    // ヤコビ法による計算 (A は対角化されるので検証用に元の行列を残す)
+    Matrix A0 = A;
     jacobi_method(A, eigenvals, eigenvecs);
     
     cout << "固有値：" << endl << eigenvals << endl;
@@ -82,17 +243,75 @@ int main() {
     
     // 結果の検証
     cout << "検証：A * v_i = λ_i * v_i" << endl;
-    for(int i = 1; i <= A.row(); i++) {
-        Vector v(A.row());
-        for(int j = 1; j <= A.row(); j++) {
+    for(int i = 1; i <= A0.row(); i++) {
+        Vector v(A0.row());
+        for(int j = 1; j <= A0.row(); j++) {
             v(j) = eigenvecs(j,i);
         }
-        Vector Av = A * v;
+        Vector Av = A0 * v;
         Vector lambdav = v * eigenvals(i);
         cout << i << "番目の固有ベクトルの検証：" << endl;
         cout << "A * v =" << endl << Av << endl;
         cout << "λ * v =" << endl << lambdav << endl << endl;
     }
     
+    // 大きな対称行列での計算時間
+    int n = params::bench_size;
+    Matrix B(n,n);
+    srand(1);
+    for(int i = 1; i <= n; i++) {
+        for(int j = 1; j <= i; j++) {
+            B(i,j) = B(j,i) = rand() / (RAND_MAX + 1.0) - 0.5;
+        }
+    }
+    Matrix B0 = B;
+    
+    cout << n << "x" << n << " の乱数対称行列：" << endl;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    jacobi_method(B, eigenvals, eigenvecs);
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    
+    // 残差 max_i ||B v_i - λ_i v_i||
+    double residual = 0.0;
+    Matrix BV = B0 * eigenvecs;
+    for(int i = 1; i <= n; i++) {
+        double sum = 0.0;
+        for(int j = 1; j <= n; j++) {
+            double r = BV(j,i) - eigenvals(i) * eigenvecs(j,i);
+            sum += r * r;
+        }
+        residual = max(residual, sqrt(sum));
+    }
+    cout << "計算時間 = " << elapsed << " s, 残差 = " << residual << endl;
+    
+    // 並列版: スレッド数ごとの計算時間と逐次版との差
+    vector<double> sequential(eigenvals.size());
+    for(int i = 1; i <= n; i++) sequential[i-1] = eigenvals(i);
+    sort(sequential.begin(), sequential.end());
+    
+    cout << "並列ヤコビ法 (ハードウェアスレッド数 = " << thread::hardware_concurrency() << ")：" << endl;
+    for(size_t t = 0; t < sizeof(params::bench_threads) / sizeof(params::bench_threads[0]); t++) {
+        int threads = params::bench_threads[t];
+        if(threads > 1 && threads > (int)thread::hardware_concurrency()) break;
+        
+        ThreadPool pool(threads);
+        B = B0;
+        start = chrono::steady_clock::now();
+        jacobi_method_parallel(B, eigenvals, eigenvecs, pool);
+        double elapsed_parallel = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        
+        vector<double> parallel(n);
+        for(int i = 1; i <= n; i++) parallel[i-1] = eigenvals(i);
+        sort(parallel.begin(), parallel.end());
+        double diff = 0.0;
+        for(int i = 0; i < n; i++) diff = max(diff, abs(parallel[i] - sequential[i]));
+        
+        cout << "  スレッド数 = " << threads << ": 計算時間 = " << elapsed_parallel << " s"
+             << ", 速度向上 = " << elapsed / elapsed_parallel << " 倍"
+             << ", 逐次版との差 = " << diff;
+        if(diff > params::eps) cout << " (警告: 許容誤差を超えています)";
+        cout << endl;
+    }
+    
     return 0;
-}
\ No newline at end of file
+}
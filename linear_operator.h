@@ -0,0 +1,424 @@
+#ifndef _linear_operator_h
+#define _linear_operator_h
+
+#include "../pch.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// 線形作用素のインターフェース
+// 反復法は行列の要素を直接見ず, 次のメンバ関数だけを使う (x, y は長さ size() の0始まりの配列)
+//   int size() const                                     作用素の次元 n
+//   void apply(const double* x, double* y) const         y = A x                 (必須)
+//   void apply_transpose(const double* x, double* y) const  y = A^T x           (任意)
+//   bool shift_solve(double sigma, const double* b, double* x) const
+//                                                        (A - σI) x = b を解く   (任意, 逆反復法で必要)
+// 密行列 Matrix は MatrixOperator, 積だけが分かる作用素は FunctionOperator, 疎行列は SparseMatrix で包む
+
+// 行列ベクトル積 y = A x のコールバック (x, y は長さ n の0始まりの配列)
+typedef std::function<void(const double* x, double* y)> MatVec;
+
+// シフト付きの連立方程式 (A - σI) x = b を解くコールバック. 解けなければ false を返す
+typedef std::function<bool(double sigma, const double* b, double* x)> ShiftSolve;
+
+// コールバックと parallel_for (thread_pool.h) の本体は std::function で渡す. std::function は捕捉が
+// ポインタ2つ分までのラムダならヒープ確保をしないので, 反復の中で作るラムダは引数を構造体にまとめ,
+// そのポインタ (と this) だけを捕捉する
+
+// 任意のメンバ関数を持つかどうかの判定
+template <class Op>
+struct has_apply_transpose {
+    template <class T>
+    static auto test(int) -> decltype(std::declval<const T&>().apply_transpose((const double*)0, (double*)0),
+                                      std::true_type());
+    template <class T>
+    static std::false_type test(...);
+    static const bool value = decltype(test<Op>(0))::value;
+};
+
+template <class Op>
+struct has_shift_solve {
+    template <class T>
+    static auto test(int) -> decltype(std::declval<const T&>().shift_solve(0.0, (const double*)0, (double*)0),
+                                      std::true_type());
+    template <class T>
+    static std::false_type test(...);
+    static const bool value = decltype(test<Op>(0))::value;
+};
+
+// 作用素をコールバックに変換する (作用素は参照で持つので, コールバックより長く生きていること)
+template <class Op>
+MatVec make_matvec(const Op& A) {
+    return [&A](const double* x, double* y) { A.apply(x, y); };
+}
+
+template <class Op>
+ShiftSolve make_shift_solve(const Op& A) {
+    static_assert(has_shift_solve<Op>::value, "作用素に shift_solve がありません");
+    return [&A](double sigma, const double* b, double* x) { return A.shift_solve(sigma, b, x); };
+}
+
+// 密行列 Matrix の作用素
+// shift_solve は (A - σI) の LU 分解を直前の σ について覚えておき, 同じ σ なら分解を使い回す
+// (分解と右辺の領域は最初の shift_solve で確保するので, apply だけなら作用素を作ってもヒープ確保はない)
+class MatrixOperator {
+public:
+    explicit MatrixOperator(const Matrix& A) : A_(&A), factored_(false), sigma_(0.0) {}
+    MatrixOperator(const MatrixOperator& other) : A_(other.A_), factored_(false), sigma_(0.0) {}
+
+    int size() const { return A_->row(); }
+
+    // 大きな行列では共有スレッドプール (thread_pool.h) で行を分けて計算する
+    void apply(const double* x, double* y) const {
+        struct Args { const double* x; double* y; } args = {x, y};
+        const MatrixOperator* self = this;
+        Args* a = &args;
+        int n = A_->row();
+        shared_parallel_for(1, n + 1, 64, (double)n * n, [self, a](int lo, int hi) {
+            const Matrix& A = *self->A_;
+            for (int i = lo; i < hi; ++i) {
+                double sum = 0.0;
+                for (int j = 1; j <= A.col(); ++j) sum += A(i, j) * a->x[j-1];
+                a->y[i-1] = sum;
+            }
+        });
+    }
+
+    // 列を分けて, 各スレッドは自分の列の y を行の順に積み上げる
+    void apply_transpose(const double* x, double* y) const {
+        struct Args { const double* x; double* y; } args = {x, y};
+        const MatrixOperator* self = this;
+        Args* a = &args;
+        int n = A_->row();
+        shared_parallel_for(1, n + 1, 64, (double)n * n, [self, a](int lo, int hi) {
+            const Matrix& A = *self->A_;
+            std::fill(a->y + lo - 1, a->y + hi - 1, 0.0);
+            for (int i = 1; i <= A.row(); ++i) {
+                double xi = a->x[i-1];
+                for (int j = lo; j < hi; ++j) a->y[j-1] += A(i, j) * xi;
+            }
+        });
+    }
+
+    bool shift_solve(double sigma, const double* b, double* x) const {
+        int n = A_->row();
+        if (!factored_ || sigma != sigma_) {
+            if (!lu_) {
+                lu_.reset(new Matrix(*A_));
+                rhs_.reset(new Vector(n));
+            } else {
+                *lu_ = *A_;
+            }
+            for (int i = 1; i <= n; ++i) (*lu_)(i, i) -= sigma;
+            pivot_.resize(n + 1);
+            LUdcp(*lu_, &pivot_[0]);
+            factored_ = true;
+            sigma_ = sigma;
+        }
+        Vector& v = *rhs_;
+        for (int i = 1; i <= n; ++i) v(i) = b[i-1];
+        LUslv(*lu_, v, &pivot_[0]);
+        bool finite = true;
+        for (int i = 1; i <= n; ++i) {
+            x[i-1] = v(i);
+            finite = finite && std::abs(v(i)) <= std::numeric_limits<double>::max();
+        }
+        return finite;
+    }
+
+private:
+    const Matrix* A_;
+    mutable std::unique_ptr<Matrix> lu_;
+    mutable std::unique_ptr<Vector> rhs_;   // LUslv に渡す右辺と解
+    mutable std::vector<int> pivot_;
+    mutable bool factored_;
+    mutable double sigma_;
+};
+
+// 積 (と必要なら転置との積) だけが分かる作用素. ヤコビ行列とベクトルの積などに使う
+class FunctionOperator {
+public:
+    FunctionOperator(int n, const MatVec& apply, const MatVec& apply_transpose = MatVec())
+        : n_(n), apply_(apply), apply_transpose_(apply_transpose) {}
+
+    int size() const { return n_; }
+    void apply(const double* x, double* y) const { apply_(x, y); }
+    void apply_transpose(const double* x, double* y) const { apply_transpose_(x, y); }
+
+private:
+    int n_;
+    MatVec apply_, apply_transpose_;
+};
+
+// 転置作用素 A^T (左固有ベクトルを求めるときに使う). A は apply_transpose を持つこと
+template <class Op>
+class TransposeOperator {
+public:
+    static_assert(has_apply_transpose<Op>::value, "作用素に apply_transpose がありません");
+
+    explicit TransposeOperator(const Op& A) : A_(&A) {}
+
+    int size() const { return A_->size(); }
+    void apply(const double* x, double* y) const { A_->apply_transpose(x, y); }
+    void apply_transpose(const double* x, double* y) const { A_->apply(x, y); }
+
+private:
+    const Op* A_;
+};
+
+// 行列要素の三つ組 (行, 列, 値). 添字は Matrix と同じく1始まり
+struct Triplet {
+    int row, col;
+    double value;
+};
+
+// GMRES の作業領域 (同じ大きさで使い回せば呼び出しごとの確保がない)
+struct GmresWorkspace {
+    std::vector<double> V, H, cs, sn, g;
+};
+
+// (A - σI) x = b をリスタート付き GMRES で解く (x は初期値として使い, 解で上書きする)
+// restart 本の Krylov 基底ごとに最小残差解を求めて再出発し, 残差が tolerance ||b|| 以下になるか
+// 積の回数が max_iterations に達したら止める. 積の回数を返す
+template <class Op>
+int gmres(const Op& A, double sigma, const double* b, double* x, GmresWorkspace& work, int restart = 30,
+          int max_iterations = 1000, double tolerance = 1e-10) {
+    int n = A.size();
+    restart = std::max(1, std::min(restart, n));
+    std::vector<double>& V = work.V;
+    std::vector<double>& H = work.H;
+    std::vector<double>& cs = work.cs;
+    std::vector<double>& sn = work.sn;
+    std::vector<double>& g = work.g;
+    V.resize((size_t)(restart + 1) * n);
+    H.resize((size_t)(restart + 1) * restart);
+    cs.resize(restart);
+    sn.resize(restart);
+    g.resize(restart + 1);
+    
+    double bnorm = 0.0;
+    for (int i = 0; i < n; ++i) bnorm += b[i] * b[i];
+    bnorm = std::sqrt(bnorm);
+    if (bnorm == 0.0) {
+        std::fill(x, x + n, 0.0);
+        return 0;
+    }
+    
+    int matvecs = 0;
+    while (matvecs < max_iterations) {
+        // r = b - (A - σI) x を最初の基底にする
+        double* v0 = &V[0];
+        A.apply(x, v0);
+        double beta = 0.0;
+        for (int i = 0; i < n; ++i) {
+            v0[i] = b[i] - (v0[i] - sigma * x[i]);
+            beta += v0[i] * v0[i];
+        }
+        beta = std::sqrt(beta);
+        if (beta <= tolerance * bnorm) break;
+        for (int i = 0; i < n; ++i) v0[i] /= beta;
+        std::fill(g.begin(), g.end(), 0.0);
+        g[0] = beta;
+        
+        // Arnoldi 過程 (修正グラム・シュミット) と Givens 回転による最小二乗問題の更新
+        int j;
+        for (j = 0; j < restart && matvecs < max_iterations; ++j) {
+            double* vj = &V[(size_t)j * n];
+            double* vn = &V[(size_t)(j + 1) * n];
+            A.apply(vj, vn);
+            matvecs++;
+            for (int i = 0; i < n; ++i) vn[i] -= sigma * vj[i];
+            for (int k = 0; k <= j; ++k) {
+                const double* vk = &V[(size_t)k * n];
+                double h = 0.0;
+                for (int i = 0; i < n; ++i) h += vk[i] * vn[i];
+                for (int i = 0; i < n; ++i) vn[i] -= h * vk[i];
+                H[(size_t)k * restart + j] = h;
+            }
+            double h_next = 0.0;
+            for (int i = 0; i < n; ++i) h_next += vn[i] * vn[i];
+            h_next = std::sqrt(h_next);
+            if (h_next > 0.0) {
+                for (int i = 0; i < n; ++i) vn[i] /= h_next;
+            }
+            
+            for (int k = 0; k < j; ++k) {
+                double a = H[(size_t)k * restart + j], c = H[(size_t)(k + 1) * restart + j];
+                H[(size_t)k * restart + j] = cs[k] * a + sn[k] * c;
+                H[(size_t)(k + 1) * restart + j] = -sn[k] * a + cs[k] * c;
+            }
+            double a = H[(size_t)j * restart + j];
+            double r = std::hypot(a, h_next);
+            cs[j] = (r == 0.0) ? 1.0 : a / r;
+            sn[j] = (r == 0.0) ? 0.0 : h_next / r;
+            H[(size_t)j * restart + j] = r;
+            g[j + 1] = -sn[j] * g[j];
+            g[j] = cs[j] * g[j];
+            
+            if (std::abs(g[j + 1]) <= tolerance * bnorm || h_next == 0.0) {
+                j++;
+                break;
+            }
+        }
+        
+        // 上三角系 H y = g を解いて x += V y
+        for (int k = j - 1; k >= 0; --k) {
+            double sum = g[k];
+            for (int l = k + 1; l < j; ++l) sum -= H[(size_t)k * restart + l] * g[l];
+            double diag = H[(size_t)k * restart + k];
+            g[k] = (diag == 0.0) ? 0.0 : sum / diag;
+        }
+        for (int k = 0; k < j; ++k) {
+            const double* vk = &V[(size_t)k * n];
+            for (int i = 0; i < n; ++i) x[i] += g[k] * vk[i];
+        }
+        if (std::abs(g[j]) <= tolerance * bnorm) break;
+    }
+    return matvecs;
+}
+
+template <class Op>
+int gmres(const Op& A, double sigma, const double* b, double* x, int restart = 30, int max_iterations = 1000,
+          double tolerance = 1e-10) {
+    GmresWorkspace work;
+    return gmres(A, sigma, b, x, work, restart, max_iterations, tolerance);
+}
+
+// 圧縮行格納 (CSR) の疎行列
+// 行 i (0始まり) の非零要素は values[row_ptr[i] .. row_ptr[i+1]-1] にあり, その列は col_idx に入る.
+// set_thread_pool でスレッドプールを渡すと, 積を非零要素の数が揃うように分けた行のまとまりごとに並列に計算する.
+// shift_solve は GMRES による反復解法なので, 分解のための fill-in が起きない.
+// GMRES の作業領域は最初の shift_solve で確保して使い回す
+class SparseMatrix {
+public:
+    SparseMatrix() : n_(0), row_ptr_(1, 0), pool_(nullptr) {}
+
+    // n x n の疎行列を三つ組から作る. 同じ位置の要素は足し合わせる
+    SparseMatrix(int n, std::vector<Triplet> triplets) : n_(n), row_ptr_(n + 1, 0), pool_(nullptr) {
+        std::sort(triplets.begin(), triplets.end(), [](const Triplet& a, const Triplet& b) {
+            return a.row != b.row ? a.row < b.row : a.col < b.col;
+        });
+        for (size_t t = 0; t < triplets.size(); ++t) {
+            const Triplet& e = triplets[t];
+            if (!col_idx_.empty() && t > 0 && triplets[t-1].row == e.row && triplets[t-1].col == e.col) {
+                values_.back() += e.value;
+                continue;
+            }
+            col_idx_.push_back(e.col - 1);
+            values_.push_back(e.value);
+            row_ptr_[e.row]++;
+        }
+        for (int i = 0; i < n_; ++i) row_ptr_[i+1] += row_ptr_[i];
+    }
+
+    // 密行列から作る. 絶対値が drop_tolerance 以下の要素は捨てる
+    explicit SparseMatrix(const Matrix& A, double drop_tolerance = 0.0)
+        : n_(A.row()), row_ptr_(A.row() + 1, 0), pool_(nullptr) {
+        for (int i = 1; i <= n_; ++i) {
+            for (int j = 1; j <= n_; ++j) {
+                if (std::abs(A(i, j)) > drop_tolerance) {
+                    col_idx_.push_back(j - 1);
+                    values_.push_back(A(i, j));
+                }
+            }
+            row_ptr_[i] = (int)values_.size();
+        }
+    }
+
+    int size() const { return n_; }
+    int nonzeros() const { return (int)values_.size(); }
+
+    // 積を並列に計算するスレッドプール (nullptr なら逐次)
+    void set_thread_pool(ThreadPool* pool) {
+        pool_ = pool;
+        parts_.clear();
+        if (!pool_ || pool_->size() == 1) return;
+        
+        // 1スレッドあたり4つ程度に, 非零要素 (と行) の数がほぼ等しくなるように行を分ける
+        int count = 4 * pool_->size();
+        double per_part = (double)(nonzeros() + n_) / count;
+        parts_.push_back(0);
+        for (int i = 0; i < n_; ++i) {
+            if (row_ptr_[i+1] + i + 1 >= per_part * (double)parts_.size() && (int)parts_.size() < count) {
+                parts_.push_back(i + 1);
+            }
+        }
+        if (parts_.back() != n_) parts_.push_back(n_);
+    }
+
+    void apply(const double* x, double* y) const {
+        if (parts_.empty() || n_ < parallel_min_rows) {
+            apply_rows(0, n_, x, y);
+            return;
+        }
+        struct Args { const double* x; double* y; } args = {x, y};
+        const SparseMatrix* self = this;
+        Args* a = &args;
+        pool_->parallel_for(0, (int)parts_.size() - 1, 1, [self, a](int lo, int hi) {
+            for (int p = lo; p < hi; ++p) self->apply_rows(self->parts_[p], self->parts_[p+1], a->x, a->y);
+        });
+    }
+
+    void apply_transpose(const double* x, double* y) const {
+        std::fill(y, y + n_, 0.0);
+        for (int i = 0; i < n_; ++i) {
+            double xi = x[i];
+            for (int p = row_ptr_[i]; p < row_ptr_[i+1]; ++p) y[col_idx_[p]] += values_[p] * xi;
+        }
+    }
+
+    // GMRES が収束せず, 相対残差 ||b - (A - σI) x|| / ||b|| が solve_tolerance を超えたら false を返す
+    // (シフトが固有値にほとんど一致して GMRES が停滞したときに, 呼び出し側がシフトをずらせるように)
+    bool shift_solve(double sigma, const double* b, double* x) const {
+        std::fill(x, x + n_, 0.0);
+        gmres(*this, sigma, b, x, gmres_work_, 30, 1000, gmres_tolerance);
+        
+        // GMRES の残差は漸化式による見積もりなので, 積を1回計算して確かめる
+        residual_.resize(n_);
+        apply(x, &residual_[0]);
+        double r2 = 0.0, b2 = 0.0;
+        for (int i = 0; i < n_; ++i) {
+            double r = b[i] - (residual_[i] - sigma * x[i]);
+            r2 += r * r;
+            b2 += b[i] * b[i];
+        }
+        return r2 <= solve_tolerance * solve_tolerance * b2;
+    }
+
+private:
+    static const int parallel_min_rows = 1000;  // これより小さい行列では並列化しない
+    static constexpr double gmres_tolerance = 1e-10;   // shift_solve で GMRES が目指す相対残差
+    static constexpr double solve_tolerance = 1e-8;    // shift_solve が解けたとみなす相対残差
+
+    int n_;
+    std::vector<int> row_ptr_, col_idx_;
+    std::vector<double> values_;
+    ThreadPool* pool_;
+    std::vector<int> parts_;   // 並列に計算する行のまとまりの境界
+    mutable GmresWorkspace gmres_work_;
+    mutable std::vector<double> residual_;
+
+    // y[lo..hi-1] = A(lo..hi-1, :) x
+    void apply_rows(int lo, int hi, const double* x, double* y) const {
+        const int* col = col_idx_.empty() ? nullptr : &col_idx_[0];
+        const double* val = values_.empty() ? nullptr : &values_[0];
+        for (int i = lo; i < hi; ++i) {
+            int p = row_ptr_[i], end = row_ptr_[i+1];
+            double sum0 = 0.0, sum1 = 0.0;
+            for (; p + 1 < end; p += 2) {
+                sum0 += val[p] * x[col[p]];
+                sum1 += val[p+1] * x[col[p+1]];
+            }
+            if (p < end) sum0 += val[p] * x[col[p]];
+            y[i] = sum0 + sum1;
+        }
+    }
+};
+
+#endif // _linear_operator_h
@@ -0,0 +1,829 @@
+#ifndef _small_matrix_h
+#define _small_matrix_h
+
+#include "gemm.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <vector>
+
+// 大きさがコンパイル時に決まる小さな行列 (2x2〜8x8 程度) とベクトル
+// 要素はオブジェクトの中の配列 (行優先) に持つのでヒープ確保がなく, ループの回数も定数になって展開される.
+// 集成体なので SmallMatrix<2> A = {{1, 2, 3, 4}}; のように初期化でき, constexpr の変数にもできる.
+// 参照は Matrix と同じ1始まりの (i, j)
+
+#if defined(__GNUC__) && !defined(__INTEL_COMPILER) && (__GNUC__ >= 8 || defined(__clang__))
+#define SMALL_UNROLL _Pragma("GCC unroll 16")
+#else
+#define SMALL_UNROLL
+#endif
+
+template <int N>
+struct SmallVector {
+    double a[N];
+
+    static constexpr int size() { return N; }
+    constexpr double operator()(int i) const { return a[i - 1]; }
+    double& operator()(int i) { return a[i - 1]; }
+};
+
+template <int M, int N = M>
+struct SmallMatrix {
+    double a[M * N];   // (i, j) 要素は a[(i-1) * N + (j-1)]
+
+    static constexpr int row() { return M; }
+    static constexpr int col() { return N; }
+    constexpr double operator()(int i, int j) const { return a[(i - 1) * N + (j - 1)]; }
+    double& operator()(int i, int j) { return a[(i - 1) * N + (j - 1)]; }
+
+    static SmallMatrix zero() {
+        SmallMatrix A;
+        SMALL_UNROLL
+        for (int k = 0; k < M * N; ++k) A.a[k] = 0.0;
+        return A;
+    }
+    static SmallMatrix identity() {
+        SmallMatrix A = zero();
+        for (int i = 1; i <= std::min(M, N); ++i) A(i, i) = 1.0;
+        return A;
+    }
+};
+
+template <int M, int N>
+SmallMatrix<M, N> operator+(const SmallMatrix<M, N>& A, const SmallMatrix<M, N>& B) {
+    SmallMatrix<M, N> C;
+    SMALL_UNROLL
+    for (int k = 0; k < M * N; ++k) C.a[k] = A.a[k] + B.a[k];
+    return C;
+}
+
+template <int M, int N>
+SmallMatrix<M, N> operator-(const SmallMatrix<M, N>& A, const SmallMatrix<M, N>& B) {
+    SmallMatrix<M, N> C;
+    SMALL_UNROLL
+    for (int k = 0; k < M * N; ++k) C.a[k] = A.a[k] - B.a[k];
+    return C;
+}
+
+template <int M, int N>
+SmallMatrix<M, N> operator*(double c, const SmallMatrix<M, N>& A) {
+    SmallMatrix<M, N> C;
+    SMALL_UNROLL
+    for (int k = 0; k < M * N; ++k) C.a[k] = c * A.a[k];
+    return C;
+}
+
+template <int M, int K, int N>
+SmallMatrix<M, N> operator*(const SmallMatrix<M, K>& A, const SmallMatrix<K, N>& B) {
+    SmallMatrix<M, N> C = SmallMatrix<M, N>::zero();
+    SMALL_UNROLL
+    for (int i = 1; i <= M; ++i) {
+        SMALL_UNROLL
+        for (int k = 1; k <= K; ++k) {
+            SMALL_UNROLL
+            for (int j = 1; j <= N; ++j) C(i, j) += A(i, k) * B(k, j);
+        }
+    }
+    return C;
+}
+
+template <int M, int N>
+SmallVector<M> operator*(const SmallMatrix<M, N>& A, const SmallVector<N>& x) {
+    SmallVector<M> y;
+    SMALL_UNROLL
+    for (int i = 1; i <= M; ++i) {
+        double sum = 0.0;
+        SMALL_UNROLL
+        for (int j = 1; j <= N; ++j) sum += A(i, j) * x(j);
+        y(i) = sum;
+    }
+    return y;
+}
+
+template <int M, int N>
+SmallMatrix<N, M> trans(const SmallMatrix<M, N>& A) {
+    SmallMatrix<N, M> T;
+    SMALL_UNROLL
+    for (int i = 1; i <= M; ++i) {
+        SMALL_UNROLL
+        for (int j = 1; j <= N; ++j) T(j, i) = A(i, j);
+    }
+    return T;
+}
+
+template <int N>
+double trace(const SmallMatrix<N>& A) {
+    double t = 0.0;
+    SMALL_UNROLL
+    for (int i = 1; i <= N; ++i) t += A(i, i);
+    return t;
+}
+
+constexpr double det(const SmallMatrix<2>& A) { return A(1, 1) * A(2, 2) - A(1, 2) * A(2, 1); }
+
+constexpr double det(const SmallMatrix<3>& A) {
+    return A(1, 1) * (A(2, 2) * A(3, 3) - A(2, 3) * A(3, 2))
+         - A(1, 2) * (A(2, 1) * A(3, 3) - A(2, 3) * A(3, 1))
+         + A(1, 3) * (A(2, 1) * A(3, 2) - A(2, 2) * A(3, 1));
+}
+
+template <int N>
+bool small_is_symmetric(const SmallMatrix<N>& A, double tolerance = 1e-14) {
+    SMALL_UNROLL
+    for (int i = 1; i <= N; ++i) {
+        SMALL_UNROLL
+        for (int j = i + 1; j <= N; ++j) {
+            if (std::abs(A(i, j) - A(j, i)) > tolerance * (std::abs(A(i, j)) + std::abs(A(j, i)))) return false;
+        }
+    }
+    return true;
+}
+
+// [a b; c d] の固有値 (実数なら l1 >= l2, 複素数なら l1 の虚部が正)
+// 固有値 d + p ± r (p = (a - d)/2) のうち小さい方は積から求めて桁落ちを避ける
+inline void small_eigenvalues_2x2(double a, double b, double c, double d,
+                                  std::complex<double>& l1, std::complex<double>& l2) {
+    double p = 0.5 * (a - d);
+    double disc = p * p + b * c;
+    if (disc >= 0.0) {
+        double r = std::sqrt(disc);
+        double z = p + (p >= 0.0 ? r : -r);
+        double x = d + z;
+        double y = z != 0.0 ? d - b * c / z : d;
+        l1 = std::complex<double>(std::max(x, y), 0.0);
+        l2 = std::complex<double>(std::min(x, y), 0.0);
+    } else {
+        double im = std::sqrt(-disc);
+        l1 = std::complex<double>(d + p, im);
+        l2 = std::complex<double>(d + p, -im);
+    }
+}
+
+// 小さな行列のヘッセンベルグ化 (鏡像変換, H を上書き)
+template <int N>
+void small_hessenberg(SmallMatrix<N>& H) {
+    double v[N];
+    for (int k = 1; k <= N - 2; ++k) {
+        double norm_x = 0.0;
+        for (int i = k + 1; i <= N; ++i) norm_x += H(i, k) * H(i, k);
+        norm_x = std::sqrt(norm_x);
+        if (norm_x == 0.0) continue;
+        double alpha = H(k + 1, k) > 0 ? -norm_x : norm_x;
+        for (int i = k + 1; i <= N; ++i) v[i - 1] = H(i, k);
+        v[k] -= alpha;
+        double vv = 0.0;
+        for (int i = k + 1; i <= N; ++i) vv += v[i - 1] * v[i - 1];
+        double beta = 2.0 / vv;
+
+        for (int j = k + 1; j <= N; ++j) {
+            double w = 0.0;
+            for (int i = k + 1; i <= N; ++i) w += v[i - 1] * H(i, j);
+            w *= beta;
+            for (int i = k + 1; i <= N; ++i) H(i, j) -= w * v[i - 1];
+        }
+        for (int i = 1; i <= N; ++i) {
+            double w = 0.0;
+            for (int j = k + 1; j <= N; ++j) w += H(i, j) * v[j - 1];
+            w *= beta;
+            for (int j = k + 1; j <= N; ++j) H(i, j) -= w * v[j - 1];
+        }
+        H(k + 1, k) = alpha;
+        for (int i = k + 2; i <= N; ++i) H(i, k) = 0.0;
+    }
+}
+
+// 上ヘッセンベルグ行列の行と列 lo..hi の Francis ダブルシフトQR法の1反復
+// (固有値だけを求めるので, ブロックの外の要素は更新しない)
+template <int N>
+void small_francis_step(SmallMatrix<N>& H, int lo, int hi, int stall) {
+    double a = H(hi - 1, hi - 1), b = H(hi - 1, hi), c = H(hi, hi - 1), d = H(hi, hi);
+    double trace_s = a + d, det_s = a * d - b * c;
+    if (stall % 11 == 10) {   // 停滞したら例外シフト
+        double e = std::abs(H(hi, hi - 1)) + (hi - 2 >= lo ? std::abs(H(hi - 1, hi - 2)) : 0.0);
+        trace_s = 2.0 * d + 1.5 * e;
+        det_s = (d + 0.75 * e) * (d + 0.75 * e) + 0.4375 * e * e;
+    }
+    double x = H(lo, lo) * H(lo, lo) + H(lo, lo + 1) * H(lo + 1, lo) - trace_s * H(lo, lo) + det_s;
+    double y = H(lo + 1, lo) * (H(lo, lo) + H(lo + 1, lo + 1) - trace_s);
+    double z = lo + 2 <= hi ? H(lo + 1, lo) * H(lo + 2, lo + 1) : 0.0;
+
+    for (int k = lo - 1; k <= hi - 2; ++k) {
+        int r = std::min(3, hi - k);
+        double norm_x = std::sqrt(x * x + y * y + (r == 3 ? z * z : 0.0));
+        if (norm_x > 0.0) {
+            double alpha = x > 0 ? -norm_x : norm_x;
+            double v[3] = {x - alpha, y, r == 3 ? z : 0.0};
+            double beta = 2.0 / (v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+            for (int j = std::max(lo, k); j <= hi; ++j) {
+                double w = 0.0;
+                for (int i = 0; i < r; ++i) w += v[i] * H(k + 1 + i, j);
+                w *= beta;
+                for (int i = 0; i < r; ++i) H(k + 1 + i, j) -= w * v[i];
+            }
+            for (int i = lo; i <= std::min(k + r + 1, hi); ++i) {
+                double w = 0.0;
+                for (int j = 0; j < r; ++j) w += H(i, k + 1 + j) * v[j];
+                w *= beta;
+                for (int j = 0; j < r; ++j) H(i, k + 1 + j) -= w * v[j];
+            }
+            if (k >= lo) {
+                H(k + 1, k) = alpha;
+                for (int i = 2; i <= r; ++i) H(k + i, k) = 0.0;
+            }
+        }
+        if (k < hi - 2) {
+            x = H(k + 2, k + 1);
+            y = H(k + 3, k + 1);
+            z = k + 4 <= hi ? H(k + 4, k + 1) : 0.0;
+        }
+    }
+}
+
+// 小さな一般の行列の全固有値 (ヘッセンベルグ化と Francis ダブルシフトQR法, 1x1 と 2x2 は閉じた式)
+// lambda[0..N-1] に格納し, 収束しなければ false (残りは対角成分)
+template <int N>
+bool small_eigenvalues(const SmallMatrix<N>& A, std::complex<double>* lambda, int max_iterations = 30 * N) {
+    SmallMatrix<N> H = A;
+    small_hessenberg(H);
+    double anorm = 0.0;
+    for (int k = 0; k < N * N; ++k) anorm = std::max(anorm, std::abs(H.a[k]));
+    const double eps = std::numeric_limits<double>::epsilon();
+
+    int hi = N, iter = 0, stall = 0;
+    while (hi > 0) {
+        // 副対角成分が無視できるところで分けた, 右下の既約なブロック lo..hi
+        int lo = hi;
+        while (lo > 1) {
+            double s = std::abs(H(lo - 1, lo - 1)) + std::abs(H(lo, lo));
+            if (s == 0.0) s = anorm;
+            if (std::abs(H(lo, lo - 1)) <= eps * s) {
+                H(lo, lo - 1) = 0.0;
+                break;
+            }
+            --lo;
+        }
+        if (lo == hi) {
+            lambda[hi - 1] = H(hi, hi);
+            hi -= 1;
+            stall = 0;
+        } else if (lo == hi - 1) {
+            small_eigenvalues_2x2(H(lo, lo), H(lo, hi), H(hi, lo), H(hi, hi), lambda[lo - 1], lambda[hi - 1]);
+            hi -= 2;
+            stall = 0;
+        } else {
+            if (iter >= max_iterations) break;
+            small_francis_step(H, lo, hi, ++stall);
+            iter++;
+        }
+    }
+    for (int i = 1; i <= hi; ++i) lambda[i - 1] = H(i, i);
+    return hi == 0;
+}
+
+template <>
+inline bool small_eigenvalues<1>(const SmallMatrix<1>& A, std::complex<double>* lambda, int) {
+    lambda[0] = A(1, 1);
+    return true;
+}
+
+template <>
+inline bool small_eigenvalues<2>(const SmallMatrix<2>& A, std::complex<double>* lambda, int) {
+    small_eigenvalues_2x2(A(1, 1), A(1, 2), A(2, 1), A(2, 2), lambda[0], lambda[1]);
+    return true;
+}
+
+// 小さな対称行列の全固有値 (昇順). 鏡像変換で三重対角化し, Wilkinson シフトの陰的 QL 法で解く
+// (2x2 と 3x3 は閉じた式). 収束しなければ false
+template <int N>
+bool small_eigenvalues_symmetric(const SmallMatrix<N>& A, double* lambda, int max_iterations = 30) {
+    SmallMatrix<N> T = A;
+    small_hessenberg(T);
+    double* d = lambda;
+    double e[N];   // e[i] は d[i] と d[i+1] をつなぐ副対角成分, e[N-1] = 0
+    for (int i = 0; i < N; ++i) {
+        d[i] = T(i + 1, i + 1);
+        e[i] = i + 1 < N ? T(i + 2, i + 1) : 0.0;
+    }
+    const double eps = std::numeric_limits<double>::epsilon();
+
+    bool converged = true;
+    for (int l = 0; l < N; ++l) {
+        int iter = 0, m;
+        do {
+            for (m = l; m < N - 1; ++m) {
+                if (std::abs(e[m]) <= eps * (std::abs(d[m]) + std::abs(d[m + 1]))) break;
+            }
+            if (m == l) break;
+            if (iter++ == max_iterations) {
+                converged = false;
+                break;
+            }
+            double g = (d[l + 1] - d[l]) / (2.0 * e[l]);
+            double r = std::sqrt(g * g + 1.0);
+            g = d[m] - d[l] + e[l] / (g + (g >= 0.0 ? r : -r));
+            double s = 1.0, c = 1.0, p = 0.0;
+            int i;
+            for (i = m - 1; i >= l; --i) {
+                double f = s * e[i], b = c * e[i];
+                e[i + 1] = r = std::sqrt(f * f + g * g);
+                if (r == 0.0) {   // 途中で分離した
+                    d[i + 1] -= p;
+                    e[m] = 0.0;
+                    break;
+                }
+                s = f / r;
+                c = g / r;
+                g = d[i + 1] - p;
+                r = (d[i] - g) * s + 2.0 * c * b;
+                p = s * r;
+                d[i + 1] = g + p;
+                g = c * r - b;
+            }
+            if (r == 0.0 && i >= l) continue;
+            d[l] -= p;
+            e[l] = g;
+            e[m] = 0.0;
+        } while (m != l);
+    }
+    std::sort(lambda, lambda + N);
+    return converged;
+}
+
+template <>
+inline bool small_eigenvalues_symmetric<1>(const SmallMatrix<1>& A, double* lambda, int) {
+    lambda[0] = A(1, 1);
+    return true;
+}
+
+template <>
+inline bool small_eigenvalues_symmetric<2>(const SmallMatrix<2>& A, double* lambda, int) {
+    std::complex<double> l1, l2;
+    small_eigenvalues_2x2(A(1, 1), A(1, 2), A(1, 2), A(2, 2), l1, l2);
+    lambda[0] = l2.real();
+    lambda[1] = l1.real();
+    return true;
+}
+
+// 3x3 は特性方程式を三角関数で解く (B = (A - qI)/p の固有値が 2cos(φ + 2πk/3))
+template <>
+inline bool small_eigenvalues_symmetric<3>(const SmallMatrix<3>& A, double* lambda, int) {
+    double p1 = A(1, 2) * A(1, 2) + A(1, 3) * A(1, 3) + A(2, 3) * A(2, 3);
+    double q = trace(A) / 3.0;
+    double d1 = A(1, 1) - q, d2 = A(2, 2) - q, d3 = A(3, 3) - q;
+    double p2 = d1 * d1 + d2 * d2 + d3 * d3 + 2.0 * p1;
+    if (p2 == 0.0) {
+        lambda[0] = lambda[1] = lambda[2] = q;
+        return true;
+    }
+    double p = std::sqrt(p2 / 6.0);
+    SmallMatrix<3> B = {{d1 / p, A(1, 2) / p, A(1, 3) / p,
+                         A(2, 1) / p, d2 / p, A(2, 3) / p,
+                         A(3, 1) / p, A(3, 2) / p, d3 / p}};
+    double r = std::max(-1.0, std::min(1.0, 0.5 * det(B)));
+    double phi = std::acos(r) / 3.0;
+    const double two_pi_3 = 2.0943951023931954923;
+    lambda[2] = q + 2.0 * p * std::cos(phi);
+    lambda[0] = q + 2.0 * p * std::cos(phi + two_pi_3);
+    lambda[1] = 3.0 * q - lambda[0] - lambda[2];
+    return true;
+}
+
+// 多数の小さな固有値問題を共有スレッドプールでまとめて解く
+// lambda[k * N + i] が k 番目の行列の i 番目の固有値. 戻り値は収束しなかった行列の数
+template <int N>
+int small_eigenvalues_batch(const SmallMatrix<N>* A, int count, std::complex<double>* lambda) {
+    std::atomic<int> failed(0);
+    shared_parallel_for(0, count, 256, (double)count * N * N * N * 10, [&](int lo, int hi) {
+        int f = 0;
+        for (int k = lo; k < hi; ++k) {
+            if (!small_eigenvalues(A[k], lambda + (size_t)k * N)) f++;
+        }
+        if (f) failed += f;
+    });
+    return failed;
+}
+
+template <int N>
+int small_eigenvalues_symmetric_batch(const SmallMatrix<N>* A, int count, double* lambda) {
+    std::atomic<int> failed(0);
+    shared_parallel_for(0, count, 256, (double)count * N * N * N * 10, [&](int lo, int hi) {
+        int f = 0;
+        for (int k = lo; k < hi; ++k) {
+            if (!small_eigenvalues_symmetric(A[k], lambda + (size_t)k * N)) f++;
+        }
+        if (f) failed += f;
+    });
+    return failed;
+}
+
+// 多数の小さな行列の束 (structure of arrays)
+// 同じ位置の要素を行列の番号の順に並べるので, 連続する W 個の行列の (i, j) 要素は1回の SIMD ロードで読める.
+// 行列の番号 k は0始まり, 要素の位置 (i, j) は1始まり
+template <int N>
+class SmallMatrixBatch {
+public:
+    explicit SmallMatrixBatch(int count = 0) : count_(count), a_((size_t)N * N * count, 0.0) {}
+
+    int size() const { return count_; }
+    void resize(int count) {
+        count_ = count;
+        a_.assign((size_t)N * N * count, 0.0);
+    }
+
+    double& operator()(int k, int i, int j) { return a_[((size_t)(i - 1) * N + (j - 1)) * count_ + k]; }
+    double operator()(int k, int i, int j) const { return a_[((size_t)(i - 1) * N + (j - 1)) * count_ + k]; }
+    // (i, j) 要素を並べた長さ size() の配列
+    const double* element(int i, int j) const { return &a_[((size_t)(i - 1) * N + (j - 1)) * count_]; }
+
+    void set(int k, const SmallMatrix<N>& A) {
+        for (int e = 0; e < N * N; ++e) a_[(size_t)e * count_ + k] = A.a[e];
+    }
+    SmallMatrix<N> get(int k) const {
+        SmallMatrix<N> A;
+        for (int e = 0; e < N * N; ++e) A.a[e] = a_[(size_t)e * count_ + k];
+        return A;
+    }
+
+private:
+    int count_;
+    std::vector<double> a_;
+};
+
+// 以下は W 個の行列 (レーン) を1組として, 同じ演算を全レーンに SIMD で並べて行う解法.
+// レーンの組は GCC のベクトル型 (W = 2, 4, 8 の double) で持ち, h[(i-1)*N + (j-1)][l] が l 番目の行列の (i, j) 要素.
+// 収束したレーンや変換の範囲外のレーンは, 回転や鏡像変換を恒等変換 (t = 0 や beta = 0) にしてマスクする
+#if defined(__GNUC__)
+#define SMALL_LANES 1
+#define SMALL_LANES_INLINE inline __attribute__((always_inline))
+
+typedef double small_lanes2 __attribute__((vector_size(16)));
+typedef double small_lanes4 __attribute__((vector_size(32)));
+typedef double small_lanes8 __attribute__((vector_size(64)));
+
+// 各レーンの平方根で x を置き換える (ベクトル型の値渡しは呼び出し規約が幅で変わるので参照で受ける)
+#ifdef GEMM_X86
+inline void small_lanes_sqrt(small_lanes2& x) { x = _mm_sqrt_pd(x); }
+__attribute__((target("avx2,fma"))) inline void small_lanes_sqrt(small_lanes4& x) { x = _mm256_sqrt_pd(x); }
+__attribute__((target("avx512f"))) inline void small_lanes_sqrt(small_lanes8& x) { x = _mm512_maskz_sqrt_pd(0xff, x); }
+#else
+template <class V>
+inline void small_lanes_sqrt(V& x) {
+    for (int l = 0; l < (int)(sizeof(V) / sizeof(double)); ++l) x[l] = std::sqrt(x[l]);
+}
+#endif
+
+// 対称行列の巡回ヤコビ法. active[l] が立っているレーンだけを回し, 収束したレーンは落とす.
+// 戻り値は max_sweeps 回で収束しなかったレーンの数
+template <int N, class V>
+SMALL_LANES_INLINE int small_lanes_jacobi(V* S, bool* active, int max_sweeps) {
+    const int W = sizeof(V) / sizeof(double);
+    const double eps = std::numeric_limits<double>::epsilon();
+    const V zero = {}, one = zero + 1.0;
+    for (int sweep = 0; ; ++sweep) {
+        V off = zero, diag = zero;
+        for (int i = 1; i <= N; ++i) {
+            diag += S[(i - 1) * N + i - 1] * S[(i - 1) * N + i - 1];
+            for (int j = i + 1; j <= N; ++j) off += S[(i - 1) * N + j - 1] * S[(i - 1) * N + j - 1];
+        }
+        int remaining = 0;
+        V on = zero;
+        for (int l = 0; l < W; ++l) {
+            active[l] = active[l] && off[l] > eps * eps * diag[l];
+            remaining += active[l];
+            on[l] = active[l] ? 1.0 : 0.0;
+        }
+        if (remaining == 0 || sweep == max_sweeps) return remaining;
+
+        for (int p = 1; p < N; ++p) {
+            for (int q = p + 1; q <= N; ++q) {
+                V apq = S[(p - 1) * N + q - 1];
+                V theta = (S[(q - 1) * N + q - 1] - S[(p - 1) * N + p - 1]) / (2.0 * (apq != 0.0 ? apq : one));
+                V r = theta * theta + 1.0;
+                small_lanes_sqrt(r);
+                V t = (theta >= 0.0 ? one : -one) / ((theta < 0.0 ? -theta : theta) + r);
+                t = (on != 0.0) & (apq != 0.0) ? t : zero;
+                V c = t * t + 1.0;
+                small_lanes_sqrt(c);
+                c = 1.0 / c;
+                V s = t * c;
+                for (int k = 1; k <= N; ++k) {
+                    V x = S[(k - 1) * N + p - 1], y = S[(k - 1) * N + q - 1];
+                    S[(k - 1) * N + p - 1] = c * x - s * y;
+                    S[(k - 1) * N + q - 1] = s * x + c * y;
+                }
+                for (int k = 1; k <= N; ++k) {
+                    V x = S[(p - 1) * N + k - 1], y = S[(q - 1) * N + k - 1];
+                    S[(p - 1) * N + k - 1] = c * x - s * y;
+                    S[(q - 1) * N + k - 1] = s * x + c * y;
+                }
+            }
+        }
+    }
+}
+
+// 全レーンのヘッセンベルグ化 (鏡像変換)
+template <int N, class V>
+SMALL_LANES_INLINE void small_lanes_hessenberg(V* H) {
+    const V zero = {};
+    for (int k = 1; k <= N - 2; ++k) {
+        V v[N];
+        V norm2 = zero;
+        for (int i = k + 1; i <= N; ++i) norm2 += H[(i - 1) * N + k - 1] * H[(i - 1) * N + k - 1];
+        V x = H[k * N + k - 1];
+        V norm_x = norm2;
+        small_lanes_sqrt(norm_x);
+        V alpha = x > 0.0 ? -norm_x : norm_x;
+        V vv = norm2 - 2.0 * alpha * x + alpha * alpha;
+        V beta = norm_x > 0.0 ? 2.0 / (norm_x > 0.0 ? vv : zero + 1.0) : zero;
+        v[k] = x - alpha;
+        for (int i = k + 2; i <= N; ++i) v[i - 1] = H[(i - 1) * N + k - 1];
+
+        for (int j = k + 1; j <= N; ++j) {
+            V w = zero;
+            for (int i = k + 1; i <= N; ++i) w += v[i - 1] * H[(i - 1) * N + j - 1];
+            w *= beta;
+            for (int i = k + 1; i <= N; ++i) H[(i - 1) * N + j - 1] -= w * v[i - 1];
+        }
+        for (int i = 1; i <= N; ++i) {
+            V w = zero;
+            for (int j = k + 1; j <= N; ++j) w += H[(i - 1) * N + j - 1] * v[j - 1];
+            w *= beta;
+            for (int j = k + 1; j <= N; ++j) H[(i - 1) * N + j - 1] -= w * v[j - 1];
+        }
+        H[k * N + k - 1] = beta != 0.0 ? alpha : H[k * N + k - 1];
+        for (int i = k + 2; i <= N; ++i) H[(i - 1) * N + k - 1] = beta != 0.0 ? zero : H[(i - 1) * N + k - 1];
+    }
+}
+
+// 全レーンの Francis ダブルシフトQR法 (H は上ヘッセンベルグ行列の組)
+// 収縮の判定とシフトの計算はレーンごとに行い, 各レーンは右下の既約なブロック lo..hi だけを反復する.
+// バルジを追い出す鏡像変換は位置 k ごとに全レーンで同時に計算し, k が範囲外のレーンでは beta = 0 にする.
+// 固有値は re[i-1][l], im[i-1][l] に入れ, 戻り値は max_iterations 回で収束しなかったレーンの数
+template <int N, class V>
+SMALL_LANES_INLINE int small_lanes_francis(V* H, V* re, V* im, bool* converged, int max_iterations) {
+    const int W = sizeof(V) / sizeof(double);
+    const double eps = std::numeric_limits<double>::epsilon();
+    const V zero = {};
+    int lo[W], hi[W], stall[W], iter[W];
+    bool done[W];
+    V x0 = zero, y0 = zero, z0 = zero;
+    for (int l = 0; l < W; ++l) {
+        hi[l] = N;
+        lo[l] = 1;
+        stall[l] = iter[l] = 0;
+        done[l] = false;
+        converged[l] = true;
+    }
+#define SMALL_H(i, j) H[((i) - 1) * N + (j) - 1]
+
+    for (;;) {
+        // レーンごとの収縮とシフト
+        int busy = 0;
+        for (int l = 0; l < W; ++l) {
+            if (done[l]) continue;
+            while (hi[l] > 0) {
+                int h = hi[l], g = h;
+                while (g > 1) {
+                    double s = std::abs(SMALL_H(g - 1, g - 1)[l]) + std::abs(SMALL_H(g, g)[l]);
+                    if (std::abs(SMALL_H(g, g - 1)[l]) <= eps * s || SMALL_H(g, g - 1)[l] == 0.0) {
+                        SMALL_H(g, g - 1)[l] = 0.0;
+                        break;
+                    }
+                    --g;
+                }
+                lo[l] = g;
+                if (g == h) {
+                    re[h - 1][l] = SMALL_H(h, h)[l];
+                    im[h - 1][l] = 0.0;
+                    hi[l] -= 1;
+                } else if (g == h - 1) {
+                    std::complex<double> l1, l2;
+                    small_eigenvalues_2x2(SMALL_H(g, g)[l], SMALL_H(g, h)[l], SMALL_H(h, g)[l], SMALL_H(h, h)[l], l1, l2);
+                    re[g - 1][l] = l1.real();
+                    im[g - 1][l] = l1.imag();
+                    re[h - 1][l] = l2.real();
+                    im[h - 1][l] = l2.imag();
+                    hi[l] -= 2;
+                } else {
+                    break;
+                }
+                stall[l] = 0;
+            }
+            if (hi[l] > 0 && iter[l] >= max_iterations) {
+                for (int i = 1; i <= hi[l]; ++i) {
+                    re[i - 1][l] = SMALL_H(i, i)[l];
+                    im[i - 1][l] = 0.0;
+                }
+                converged[l] = false;
+                hi[l] = 0;
+            }
+            if (hi[l] == 0) {
+                done[l] = true;
+                continue;
+            }
+
+            int g = lo[l], h = hi[l];
+            double a = SMALL_H(h - 1, h - 1)[l], b = SMALL_H(h - 1, h)[l], c = SMALL_H(h, h - 1)[l], d = SMALL_H(h, h)[l];
+            double trace_s = a + d, det_s = a * d - b * c;
+            if (++stall[l] % 11 == 10) {   // 停滞したら例外シフト
+                double e = std::abs(SMALL_H(h, h - 1)[l]) + std::abs(SMALL_H(h - 1, h - 2)[l]);
+                trace_s = 2.0 * d + 1.5 * e;
+                det_s = (d + 0.75 * e) * (d + 0.75 * e) + 0.4375 * e * e;
+            }
+            x0[l] = SMALL_H(g, g)[l] * SMALL_H(g, g)[l] + SMALL_H(g, g + 1)[l] * SMALL_H(g + 1, g)[l]
+                    - trace_s * SMALL_H(g, g)[l] + det_s;
+            y0[l] = SMALL_H(g + 1, g)[l] * (SMALL_H(g, g)[l] + SMALL_H(g + 1, g + 1)[l] - trace_s);
+            z0[l] = SMALL_H(g + 1, g)[l] * SMALL_H(g + 2, g + 1)[l];
+            iter[l]++;
+            busy++;
+        }
+        if (busy == 0) break;
+
+        // バルジの追い出し (位置 k の鏡像変換を全レーンで同時に)
+        for (int k = 0; k <= N - 2; ++k) {
+            int rows = std::min(3, N - k), k3 = std::min(k + 3, N);
+            V first = zero, active = zero, keep_z = zero;
+            for (int l = 0; l < W; ++l) {
+                first[l] = k == lo[l] - 1;
+                active[l] = !done[l] && k >= lo[l] - 1 && k <= hi[l] - 2;
+                keep_z[l] = k + 3 <= hi[l];
+            }
+            V x = k >= 1 ? SMALL_H(k + 1, k) : zero;
+            V y = k >= 1 ? SMALL_H(k + 2, k) : zero;
+            V z = k >= 1 && rows == 3 ? SMALL_H(k3, k) : zero;
+            x = first != 0.0 ? x0 : x;
+            y = first != 0.0 ? y0 : y;
+            z = first != 0.0 ? z0 : z;
+            z = keep_z != 0.0 ? z : zero;
+            V norm_x = x * x + y * y + z * z;
+            small_lanes_sqrt(norm_x);
+            V alpha = x > 0.0 ? -norm_x : norm_x;
+            V v0 = x - alpha, v1 = y, v2 = z;
+            active = (active != 0.0) & (norm_x > 0.0) ? zero + 1.0 : zero;
+            V beta = active != 0.0 ? 2.0 / (v0 * v0 + v1 * v1 + v2 * v2 + (active != 0.0 ? zero : zero + 1.0)) : zero;
+
+            for (int j = std::max(1, k); j <= N; ++j) {
+                V w = v0 * SMALL_H(k + 1, j) + v1 * SMALL_H(k + 2, j);
+                if (rows == 3) w += v2 * SMALL_H(k3, j);
+                w *= beta;
+                SMALL_H(k + 1, j) -= w * v0;
+                SMALL_H(k + 2, j) -= w * v1;
+                if (rows == 3) SMALL_H(k3, j) -= w * v2;
+            }
+            for (int i = 1; i <= std::min(k + 4, N); ++i) {
+                V w = SMALL_H(i, k + 1) * v0 + SMALL_H(i, k + 2) * v1;
+                if (rows == 3) w += SMALL_H(i, k3) * v2;
+                w *= beta;
+                SMALL_H(i, k + 1) -= w * v0;
+                SMALL_H(i, k + 2) -= w * v1;
+                if (rows == 3) SMALL_H(i, k3) -= w * v2;
+            }
+            if (k >= 1) {
+                // バルジを消した列は値を正確に入れる
+                V store = (active != 0.0) & (first == 0.0) ? zero + 1.0 : zero;
+                SMALL_H(k + 1, k) = store != 0.0 ? alpha : SMALL_H(k + 1, k);
+                SMALL_H(k + 2, k) = store != 0.0 ? zero : SMALL_H(k + 2, k);
+                if (rows == 3) SMALL_H(k3, k) = store != 0.0 ? zero : SMALL_H(k3, k);
+            }
+        }
+    }
+#undef SMALL_H
+    int failed = 0;
+    for (int l = 0; l < W; ++l) failed += !converged[l];
+    return failed;
+}
+
+// 束の [begin, end) 番目の行列を W 個ずつの組に写して解く (端数の組は最後の行列で埋める)
+// 固有値は re[(i-1) * count + k], im[(i-1) * count + k] (対称なら im は使わず, 昇順)
+template <int N, class V>
+SMALL_LANES_INLINE int small_lanes_batch(const SmallMatrixBatch<N>& A, int begin, int end, bool symmetric,
+                                         double* re, double* im, char* converged, int max_iterations) {
+    const int W = sizeof(V) / sizeof(double);
+    int count = A.size(), failed = 0;
+    for (int base = begin; base < end; base += W) {
+        V h[N * N], er[N], ei[N];
+        bool ok[W];
+        int lanes = std::min(W, end - base);
+        for (int e = 0; e < N * N; ++e) {
+            const double* src = A.element(e / N + 1, e % N + 1) + base;
+            for (int l = 0; l < W; ++l) h[e][l] = src[l < lanes ? l : lanes - 1];
+        }
+        if (symmetric) {
+            for (int l = 0; l < W; ++l) ok[l] = true;
+            small_lanes_jacobi<N, V>(h, ok, max_iterations);
+            for (int l = 0; l < W; ++l) {
+                ok[l] = !ok[l];   // 落とされずに残ったレーンが未収束
+                // 対角成分を挿入ソートで昇順にする
+                for (int i = 0; i < N; ++i) {
+                    double t = h[i * N + i][l];
+                    int j = i - 1;
+                    for (; j >= 0 && er[j][l] > t; --j) er[j + 1][l] = er[j][l];
+                    er[j + 1][l] = t;
+                }
+            }
+        } else {
+            small_lanes_hessenberg<N, V>(h);
+            small_lanes_francis<N, V>(h, er, ei, ok, max_iterations);
+        }
+        for (int l = 0; l < lanes; ++l) {
+            for (int i = 0; i < N; ++i) {
+                re[(size_t)i * count + base + l] = er[i][l];
+                if (!symmetric) im[(size_t)i * count + base + l] = ei[i][l];
+            }
+            if (converged) converged[base + l] = ok[l];
+            failed += !ok[l];
+        }
+    }
+    return failed;
+}
+
+// SIMD の幅ごとの実体 (2 は SSE2 などの 128 ビット, 4 は AVX2, 8 は AVX-512. gemm.h と同じく実行時に CPU を調べて選ぶ)
+template <int N>
+int small_lanes_batch_w2(const SmallMatrixBatch<N>& A, int begin, int end, bool symmetric, double* re, double* im,
+                           char* converged, int max_iterations) {
+    return small_lanes_batch<N, small_lanes2>(A, begin, end, symmetric, re, im, converged, max_iterations);
+}
+
+#ifdef GEMM_X86
+template <int N>
+__attribute__((target("avx2,fma")))
+int small_lanes_batch_w4(const SmallMatrixBatch<N>& A, int begin, int end, bool symmetric, double* re, double* im,
+                           char* converged, int max_iterations) {
+    return small_lanes_batch<N, small_lanes4>(A, begin, end, symmetric, re, im, converged, max_iterations);
+}
+
+template <int N>
+__attribute__((target("avx512f")))
+int small_lanes_batch_w8(const SmallMatrixBatch<N>& A, int begin, int end, bool symmetric, double* re, double* im,
+                             char* converged, int max_iterations) {
+    return small_lanes_batch<N, small_lanes8>(A, begin, end, symmetric, re, im, converged, max_iterations);
+}
+#endif
+#endif
+
+template <int N>
+int small_lanes_dispatch(const SmallMatrixBatch<N>& A, bool symmetric, double* re, double* im, char* converged,
+                         int max_iterations, GemmKernel kernel) {
+    if (!gemm_kernel_available(kernel)) kernel = GEMM_SCALAR;
+    std::atomic<int> failed(0);
+    const int block = 64;   // 1つの仕事にまとめる行列の数
+    int blocks = (A.size() + block - 1) / block;
+    shared_parallel_for(0, blocks, 1, (double)A.size() * N * N * N * 10, [&](int lo, int hi) {
+        int begin = lo * block, end = std::min(A.size(), hi * block), f = 0;
+#if defined(SMALL_LANES) && defined(GEMM_X86)
+        if (kernel == GEMM_AVX512) {
+            f = small_lanes_batch_w8<N>(A, begin, end, symmetric, re, im, converged, max_iterations);
+        } else if (kernel == GEMM_AVX2) {
+            f = small_lanes_batch_w4<N>(A, begin, end, symmetric, re, im, converged, max_iterations);
+        } else
+#endif
+        {
+#ifdef SMALL_LANES
+            f = small_lanes_batch_w2<N>(A, begin, end, symmetric, re, im, converged, max_iterations);
+#else
+            // ベクトル型のないコンパイラでは1つずつ解く
+            for (int k = begin; k < end; ++k) {
+                double d[N];
+                std::complex<double> lambda[N];
+                bool ok = symmetric ? small_eigenvalues_symmetric(A.get(k), d, max_iterations)
+                                    : small_eigenvalues(A.get(k), lambda, max_iterations);
+                for (int i = 0; i < N; ++i) {
+                    re[(size_t)i * A.size() + k] = symmetric ? d[i] : lambda[i].real();
+                    if (!symmetric) im[(size_t)i * A.size() + k] = lambda[i].imag();
+                }
+                if (converged) converged[k] = ok;
+                f += !ok;
+            }
+#endif
+        }
+        if (f) failed += f;
+    });
+    return failed;
+}
+
+// 束の解法の既定のカーネル. 8 レーンでは収束の早いレーンが遅いレーンを待つ無駄が増えるので, 使えるなら AVX2 (4 レーン) を選ぶ
+inline GemmKernel small_lanes_best_kernel() {
+    return gemm_kernel_available(GEMM_AVX2) ? GEMM_AVX2 : gemm_best_kernel();
+}
+
+// 束 (SmallMatrixBatch) の全ての行列の固有値を, 行列をまたいで SIMD で並べて求める (外側の束はスレッドで並列)
+// re, im は長さ N * A.size() で, k 番目の行列の i 番目の固有値は re[(i-1) * A.size() + k] (束と同じ並び).
+// converged (長さ A.size()) を渡すと行列ごとに収束したかを入れる. 戻り値は収束しなかった行列の数
+template <int N>
+int small_eigenvalues_batch(const SmallMatrixBatch<N>& A, double* re, double* im, char* converged = nullptr,
+                            int max_iterations = 30 * N, GemmKernel kernel = small_lanes_best_kernel()) {
+    return small_lanes_dispatch(A, false, re, im, converged, max_iterations, kernel);
+}
+
+// 対称行列の束 (巡回ヤコビ法, 固有値は昇順で lambda[(i-1) * A.size() + k]).
+// 3x3 は閉じた式を使う small_eigenvalues_symmetric を1つずつ呼ぶほうが速い
+template <int N>
+int small_eigenvalues_symmetric_batch(const SmallMatrixBatch<N>& A, double* lambda, char* converged = nullptr,
+                                      int max_sweeps = 30, GemmKernel kernel = small_lanes_best_kernel()) {
+    return small_lanes_dispatch(A, true, lambda, nullptr, converged, max_sweeps, kernel);
+}
+
+#endif
@@ -0,0 +1,233 @@
+#ifndef _thread_pool_h
+#define _thread_pool_h
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 固定数のスレッドによるワークスティーリング型のスレッドプール
+// parallel_for を呼んだスレッドも計算に加わるので, 作られる作業スレッドは num_threads - 1 本
+// 範囲は始めにスレッド数で等分して各スレッドに持たせ, 各スレッドは自分の範囲の先頭から grain 個ずつ取って処理する.
+// 自分の範囲がなくなったスレッドは, 他のスレッドの残りの後ろ半分を奪う (区間の重さに偏りがあっても均される)
+// 実行中の parallel_for の中から (または別のスレッドから同時に) 呼ばれた parallel_for は呼んだスレッドで逐次に実行する
+class ThreadPool {
+public:
+    explicit ThreadPool(int num_threads = (int)std::thread::hardware_concurrency())
+        : num_threads_(std::max(num_threads, 1)), generation_(0), busy_(0), stop_(false) {
+        for (int t = 0; t < num_threads_; ++t) slots_.push_back(std::unique_ptr<Slot>(new Slot()));
+        for (int t = 1; t < num_threads_; ++t) {
+            workers_.push_back(std::thread(&ThreadPool::worker_loop, this, t));
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (size_t t = 0; t < workers_.size(); ++t) workers_[t].join();
+    }
+
+    int size() const { return num_threads_; }
+
+    // [begin, end) を grain 個ずつの区間に分け, 各区間で f(lo, hi) を並列に呼ぶ
+    // 全ての区間が終わるまで戻らない
+    void parallel_for(int begin, int end, int grain, const std::function<void(int, int)>& f) {
+        if (end <= begin) return;
+        grain = std::max(grain, 1);
+        // このプールのジョブの中からの呼び出しは逐次に実行する. call_mutex_ は別のスレッドからの
+        // 同時の呼び出しを直列にするためだけに使う (持っているスレッドが try_lock するのは未定義動作)
+        if (num_threads_ == 1 || end - begin <= grain || inside_job() || !call_mutex_.try_lock()) {
+            f(begin, end);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job_ = &f;
+            job_grain_ = grain;
+            long long length = end - begin;
+            for (int t = 0; t < num_threads_; ++t) {
+                slots_[t]->lo = begin + (int)(length * t / num_threads_);
+                slots_[t]->hi = begin + (int)(length * (t + 1) / num_threads_);
+            }
+            busy_ = num_threads_ - 1;
+            generation_++;
+        }
+        wake_.notify_all();
+
+        {
+            JobScope scope(this);
+            run_chunks(0);
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_.wait(lock, [this] { return busy_ == 0; });
+            job_ = nullptr;
+        }
+        call_mutex_.unlock();
+    }
+
+    // 区間をスレッド数に合わせて均等に分ける parallel_for
+    void parallel_for(int begin, int end, const std::function<void(int, int)>& f) {
+        int grain = (end - begin + num_threads_ - 1) / num_threads_;
+        parallel_for(begin, end, grain, f);
+    }
+
+private:
+    // スレッドごとの残りの範囲 [lo, hi) (持ち主は先頭から, 他のスレッドは後ろから取る)
+    struct Slot {
+        std::mutex mutex;
+        int lo = 0, hi = 0;
+    };
+
+    // スレッドが実行中のジョブのプールの連鎖 (入れ子の parallel_for の検出に使う)
+    struct JobScope {
+        const ThreadPool* pool;
+        JobScope* prev;
+
+        explicit JobScope(const ThreadPool* p) : pool(p), prev(current()) { current() = this; }
+        ~JobScope() { current() = prev; }
+
+        static JobScope*& current() {
+            static thread_local JobScope* top = nullptr;
+            return top;
+        }
+    };
+
+    // 呼んだスレッドがこのプールのジョブを実行中なら true
+    bool inside_job() const {
+        for (const JobScope* scope = JobScope::current(); scope; scope = scope->prev) {
+            if (scope->pool == this) return true;
+        }
+        return false;
+    }
+
+    int num_threads_;
+    std::vector<std::thread> workers_;
+    std::vector<std::unique_ptr<Slot>> slots_;
+    std::mutex mutex_, call_mutex_;
+    std::condition_variable wake_, done_;
+    unsigned long generation_;    // parallel_for の呼び出しごとに増える
+    int busy_;                    // 現在のジョブを処理中の作業スレッド数
+    bool stop_;
+
+    const std::function<void(int, int)>* job_ = nullptr;
+    int job_grain_ = 1;
+
+    // 自分の範囲から区間を1つ取る
+    bool pop(int self, int& lo, int& hi) {
+        Slot& slot = *slots_[self];
+        std::lock_guard<std::mutex> lock(slot.mutex);
+        if (slot.lo >= slot.hi) return false;
+        lo = slot.lo;
+        hi = std::min(slot.lo + job_grain_, slot.hi);
+        slot.lo = hi;
+        return true;
+    }
+
+    // 他のスレッドの残りの後ろ半分を自分の範囲に移す
+    bool steal(int self) {
+        for (int d = 1; d < num_threads_; ++d) {
+            Slot& victim = *slots_[(self + d) % num_threads_];
+            int lo, hi;
+            {
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                int remaining = victim.hi - victim.lo;
+                if (remaining <= 0) continue;
+                hi = victim.hi;
+                lo = victim.hi - (remaining + 1) / 2;
+                victim.hi = lo;
+            }
+            Slot& slot = *slots_[self];
+            std::lock_guard<std::mutex> lock(slot.mutex);
+            slot.lo = lo;
+            slot.hi = hi;
+            return true;
+        }
+        return false;
+    }
+
+    void run_chunks(int self) {
+        const std::function<void(int, int)>& f = *job_;
+        int lo, hi;
+        while (pop(self, lo, hi) || (steal(self) && pop(self, lo, hi))) f(lo, hi);
+    }
+
+    void worker_loop(int self) {
+        unsigned long seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                if (stop_) return;
+                seen = generation_;
+            }
+
+            {
+                JobScope scope(this);
+                run_chunks(self);
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--busy_ == 0) done_.notify_one();
+        }
+    }
+};
+
+// 行列演算で共有するスレッドプール (最初に使うときにハードウェアのスレッド数で作る)
+inline std::unique_ptr<ThreadPool>& shared_thread_pool_instance(std::mutex*& mutex) {
+    static std::mutex creation;
+    static std::unique_ptr<ThreadPool> pool;
+    mutex = &creation;
+    return pool;
+}
+
+// 作るのは最初の1回だけで, 以後は排他なしで返す (プールを取り替えるのは set_shared_thread_count だけ)
+inline ThreadPool& shared_thread_pool() {
+    std::mutex* mutex;
+    std::unique_ptr<ThreadPool>& pool = shared_thread_pool_instance(mutex);
+    static std::once_flag created;
+    std::call_once(created, [&pool, mutex] {
+        std::lock_guard<std::mutex> lock(*mutex);
+        if (!pool) pool.reset(new ThreadPool());
+    });
+    return *pool;
+}
+
+// 共有スレッドプールのスレッド数を変える (0 以下ならハードウェアのスレッド数).
+// 共有スレッドプールを使う計算の実行中に呼んではいけない
+inline void set_shared_thread_count(int num_threads) {
+    if (num_threads <= 0) num_threads = (int)std::thread::hardware_concurrency();
+    std::mutex* mutex;
+    std::unique_ptr<ThreadPool>& pool = shared_thread_pool_instance(mutex);
+    std::lock_guard<std::mutex> lock(*mutex);
+    if (!pool || pool->size() != num_threads) pool.reset(new ThreadPool(num_threads));
+}
+
+// 共有スレッドプールで並列化する最小の演算量 (積和の回数). 小さな行列ではスレッドを起こすほうが高くつく
+inline double& shared_parallel_min_work() {
+    static double min_work = 1 << 17;
+    return min_work;
+}
+
+inline void set_shared_parallel_threshold(double min_work) {
+    shared_parallel_min_work() = min_work;
+}
+
+// 演算量 work が閾値以上なら共有スレッドプールで parallel_for を呼び, そうでなければ f(begin, end) を呼ぶ
+inline void shared_parallel_for(int begin, int end, int grain, double work, const std::function<void(int, int)>& f) {
+    if (work < shared_parallel_min_work() || end - begin <= grain) {
+        if (end > begin) f(begin, end);
+        return;
+    }
+    shared_thread_pool().parallel_for(begin, end, grain, f);
+}
+
+#endif // _thread_pool_h